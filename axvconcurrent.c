@@ -0,0 +1,414 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+
+#include "axvconcurrent.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define CACHE_LINE 64
+#define SEGMENT_SHIFT 6
+#define SEGMENTS (64 - SEGMENT_SHIFT)
+
+
+/*
+    Both queues count positions from 0 upward and never wrap them, the slot of a position is position & mask.
+    Members written by different threads are padded apart so they never share a cache line.
+*/
+struct axv_spsc {
+    atomic_uint_fast64_t tail;  // written by the producer
+    uint64_t cachedHead;        // producer's last seen head
+    char pad1[CACHE_LINE - 16];
+    atomic_uint_fast64_t head;  // written by the consumer
+    uint64_t cachedTail;        // consumer's last seen tail
+    char pad2[CACHE_LINE - 16];
+    void **items;
+    uint64_t mask;
+    const axv_allocator *allocator;
+    bool overlay;
+};
+
+
+typedef struct cell {
+    atomic_uint_fast64_t seq;
+    void *val;
+} cell;
+
+
+/*
+    Bounded MPMC queue after Dmitry Vyukov. A cell at position pos is free for the producer of pos if its sequence
+    number is pos, and holds an item for the consumer of pos if it is pos + 1. Consuming sets it to pos + capacity,
+    the position using the cell in the next round.
+*/
+struct axv_mpmc {
+    atomic_uint_fast64_t tail;
+    char pad1[CACHE_LINE - 8];
+    atomic_uint_fast64_t head;
+    char pad2[CACHE_LINE - 8];
+    cell *cells;
+    uint64_t mask;
+    const axv_allocator *allocator;
+};
+
+
+/*
+    Segment k of a concurrent vector holds SEGMENT_BASE << k slots, so index i lives in the segment given by the
+    position of the highest bit of i + SEGMENT_BASE. The segments are installed into the table on first use by
+    whichever thread gets there first.
+*/
+#define SEGMENT_BASE (UINT64_C(1) << SEGMENT_SHIFT)
+
+struct axv_cvec {
+    atomic_uint_fast64_t len;
+    char pad[CACHE_LINE - 8];
+    _Atomic(void **) segments[SEGMENTS];
+    const axv_allocator *allocator;
+};
+
+
+static uint64_t ceilPow2(uint64_t n) {
+    uint64_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+
+static uint64_t floorPow2(uint64_t n) {
+    uint64_t p = 1;
+    while (p <= n >> 1)
+        p <<= 1;
+    return p;
+}
+
+
+static axv_spsc *spscNew(void **items, uint64_t capacity, const axv_allocator *allocator, bool overlay) {
+    allocator = allocator ? allocator : axv_defaultAllocator();
+    axv_spsc *q = allocator->alloc(sizeof *q, allocator->ctx);
+    if (!q)
+        return NULL;
+    if (!items) {
+        items = allocator->alloc(capacity * sizeof *items, allocator->ctx);
+        if (!items) {
+            allocator->free(q, sizeof *q, allocator->ctx);
+            return NULL;
+        }
+    }
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    q->cachedHead = 0;
+    q->cachedTail = 0;
+    q->items = items;
+    q->mask = capacity - 1;
+    q->allocator = allocator;
+    q->overlay = overlay;
+    return q;
+}
+
+
+axv_spsc *axv_spscNew(uint64_t capacity, const axv_allocator *allocator) {
+    if (capacity > UINT64_C(1) << 62)
+        return NULL;
+    return spscNew(NULL, ceilPow2(capacity), allocator, false);
+}
+
+
+axv_spsc *axv_spscNewOverlay(void **items, uint64_t capacity, const axv_allocator *allocator) {
+    if (capacity == 0)
+        return NULL;
+    return spscNew(items, floorPow2(capacity), allocator, true);
+}
+
+
+void axv_spscDestroy(axv_spsc *q) {
+    const axv_allocator *allocator = q->allocator;
+    if (!q->overlay)
+        allocator->free(q->items, (q->mask + 1) * sizeof *q->items, allocator->ctx);
+    allocator->free(q, sizeof *q, allocator->ctx);
+}
+
+
+bool axv_spscPush(axv_spsc *q, void *val) {
+    return axv_spscPushN(q, &val, 1) == 0;
+}
+
+
+bool axv_spscPop(axv_spsc *q, void **val) {
+    return axv_spscPopN(q, val, 1) == 0;
+}
+
+
+uint64_t axv_spscPushN(axv_spsc *q, void **src, uint64_t n) {
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint64_t cap = q->mask + 1;
+    if (cap - (tail - q->cachedHead) < n)
+        q->cachedHead = atomic_load_explicit(&q->head, memory_order_acquire);
+    n = MIN(n, cap - (tail - q->cachedHead));
+    if (n == 0)
+        return 0;
+    uint64_t i = tail & q->mask;
+    uint64_t first = MIN(n, cap - i);
+    memcpy(q->items + i, src, first * sizeof *src);
+    memcpy(q->items, src + first, (n - first) * sizeof *src);
+    atomic_store_explicit(&q->tail, tail + n, memory_order_release);
+    return n;
+}
+
+
+uint64_t axv_spscPopN(axv_spsc *q, void **dst, uint64_t n) {
+    uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint64_t cap = q->mask + 1;
+    if (q->cachedTail - head < n)
+        q->cachedTail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    n = MIN(n, q->cachedTail - head);
+    if (n == 0)
+        return 0;
+    uint64_t i = head & q->mask;
+    uint64_t first = MIN(n, cap - i);
+    memcpy(dst, q->items + i, first * sizeof *dst);
+    memcpy(dst + first, q->items, (n - first) * sizeof *dst);
+    atomic_store_explicit(&q->head, head + n, memory_order_release);
+    return n;
+}
+
+
+uint64_t axv_spscLen(axv_spsc *q) {
+    uint64_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return tail > head ? tail - head : 0;
+}
+
+
+uint64_t axv_spscCap(axv_spsc *q) {
+    return q->mask + 1;
+}
+
+
+axv_mpmc *axv_mpmcNew(uint64_t capacity, const axv_allocator *allocator) {
+    if (capacity > UINT64_C(1) << 62)
+        return NULL;
+    capacity = ceilPow2(capacity);
+    allocator = allocator ? allocator : axv_defaultAllocator();
+    axv_mpmc *q = allocator->alloc(sizeof *q, allocator->ctx);
+    if (!q)
+        return NULL;
+    q->cells = allocator->alloc(capacity * sizeof *q->cells, allocator->ctx);
+    if (!q->cells) {
+        allocator->free(q, sizeof *q, allocator->ctx);
+        return NULL;
+    }
+    for (uint64_t i = 0; i < capacity; ++i)
+        atomic_init(&q->cells[i].seq, i);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    q->mask = capacity - 1;
+    q->allocator = allocator;
+    return q;
+}
+
+
+void axv_mpmcDestroy(axv_mpmc *q) {
+    const axv_allocator *allocator = q->allocator;
+    allocator->free(q->cells, (q->mask + 1) * sizeof *q->cells, allocator->ctx);
+    allocator->free(q, sizeof *q, allocator->ctx);
+}
+
+
+bool axv_mpmcPush(axv_mpmc *q, void *val) {
+    return axv_mpmcPushN(q, &val, 1) == 0;
+}
+
+
+bool axv_mpmcPop(axv_mpmc *q, void **val) {
+    return axv_mpmcPopN(q, val, 1) == 0;
+}
+
+
+/*
+    Claim the longest run of at most n consecutive cells starting at the current position of counter whose sequence
+    numbers equal position + offset, i.e. which are ready for the caller. Returns the length of the run and stores its
+    first position in pos. The cells of a run, once claimed by moving the counter past it, belong to the caller alone.
+*/
+static uint64_t claimRun(axv_mpmc *q, atomic_uint_fast64_t *counter, uint64_t offset, uint64_t n, uint64_t *pos) {
+    if (n == 0)
+        return 0;
+    uint64_t p = atomic_load_explicit(counter, memory_order_relaxed);
+    for (;;) {
+        uint64_t m = 0;
+        while (m < n && m <= q->mask) {
+            uint64_t seq = atomic_load_explicit(&q->cells[(p + m) & q->mask].seq, memory_order_acquire);
+            if (seq != p + m + offset)
+                break;
+            ++m;
+        }
+        if (m == 0) {
+            uint64_t seq = atomic_load_explicit(&q->cells[p & q->mask].seq, memory_order_acquire);
+            if ((int64_t) (seq - (p + offset)) < 0)
+                return 0;  // full or empty
+            // another thread claimed the position in the meantime
+            p = atomic_load_explicit(counter, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(counter, &p, p + m, memory_order_relaxed, memory_order_relaxed)) {
+            *pos = p;
+            return m;
+        }
+    }
+}
+
+
+uint64_t axv_mpmcPushN(axv_mpmc *q, void **src, uint64_t n) {
+    uint64_t pos;
+    n = claimRun(q, &q->tail, 0, n, &pos);
+    for (uint64_t i = 0; i < n; ++i) {
+        cell *c = q->cells + ((pos + i) & q->mask);
+        c->val = src[i];
+        atomic_store_explicit(&c->seq, pos + i + 1, memory_order_release);
+    }
+    return n;
+}
+
+
+uint64_t axv_mpmcPopN(axv_mpmc *q, void **dst, uint64_t n) {
+    uint64_t pos;
+    n = claimRun(q, &q->head, 1, n, &pos);
+    for (uint64_t i = 0; i < n; ++i) {
+        cell *c = q->cells + ((pos + i) & q->mask);
+        dst[i] = c->val;
+        atomic_store_explicit(&c->seq, pos + i + q->mask + 1, memory_order_release);
+    }
+    return n;
+}
+
+
+uint64_t axv_mpmcCap(axv_mpmc *q) {
+    return q->mask + 1;
+}
+
+
+static unsigned segmentOf(uint64_t index) {
+    return 63 - __builtin_clzll(index + SEGMENT_BASE) - SEGMENT_SHIFT;
+}
+
+
+static uint64_t segmentSize(unsigned k) {
+    return SEGMENT_BASE << k;
+}
+
+
+static void **loadSegment(axv_cvec *cv, unsigned k) {
+    void **segment = atomic_load_explicit(&cv->segments[k], memory_order_acquire);
+    if (segment)
+        return segment;
+    const axv_allocator *allocator = cv->allocator;
+    void **fresh = allocator->alloc(segmentSize(k) * sizeof *fresh, allocator->ctx);
+    if (!fresh)
+        return NULL;
+    // slots whose push failed to allocate their segment are never written and must read as empty
+    memset(fresh, 0, segmentSize(k) * sizeof *fresh);
+    if (atomic_compare_exchange_strong_explicit(&cv->segments[k], &segment, fresh, memory_order_acq_rel,
+                                                memory_order_acquire))
+        return fresh;
+    allocator->free(fresh, segmentSize(k) * sizeof *fresh, allocator->ctx);
+    return segment;
+}
+
+
+axv_cvec *axv_cvecNew(const axv_allocator *allocator) {
+    allocator = allocator ? allocator : axv_defaultAllocator();
+    axv_cvec *cv = allocator->alloc(sizeof *cv, allocator->ctx);
+    if (!cv)
+        return NULL;
+    atomic_init(&cv->len, 0);
+    for (unsigned k = 0; k < SEGMENTS; ++k)
+        atomic_init(&cv->segments[k], NULL);
+    cv->allocator = allocator;
+    if (!loadSegment(cv, 0)) {
+        allocator->free(cv, sizeof *cv, allocator->ctx);
+        return NULL;
+    }
+    return cv;
+}
+
+
+static void freeSegments(axv_cvec *cv) {
+    const axv_allocator *allocator = cv->allocator;
+    for (unsigned k = 0; k < SEGMENTS; ++k) {
+        void **segment = atomic_load_explicit(&cv->segments[k], memory_order_relaxed);
+        if (segment)
+            allocator->free(segment, segmentSize(k) * sizeof *segment, allocator->ctx);
+    }
+    allocator->free(cv, sizeof *cv, allocator->ctx);
+}
+
+
+void axv_cvecDestroy(axv_cvec *cv) {
+    freeSegments(cv);
+}
+
+
+bool axv_cvecPush(axv_cvec *cv, void *val) {
+    return axv_cvecPushN(cv, &val, 1);
+}
+
+
+bool axv_cvecPushN(axv_cvec *cv, void **src, uint64_t n) {
+    if (n == 0)
+        return false;
+    uint64_t i = atomic_fetch_add_explicit(&cv->len, n, memory_order_relaxed);
+    bool oom = false;
+    while (n) {
+        unsigned k = segmentOf(i);
+        uint64_t offset = i + SEGMENT_BASE - segmentSize(k);
+        uint64_t m = MIN(n, segmentSize(k) - offset);
+        void **segment = loadSegment(cv, k);
+        if (segment)
+            memcpy(segment + offset, src, m * sizeof *src);
+        else
+            oom = true;
+        src += m;
+        i += m;
+        n -= m;
+    }
+    return oom;
+}
+
+
+uint64_t axv_cvecLen(axv_cvec *cv) {
+    return atomic_load_explicit(&cv->len, memory_order_relaxed);
+}
+
+
+void *axv_cvecGet(axv_cvec *cv, uint64_t index) {
+    if (index >= atomic_load_explicit(&cv->len, memory_order_relaxed))
+        return NULL;
+    unsigned k = segmentOf(index);
+    void **segment = atomic_load_explicit(&cv->segments[k], memory_order_acquire);
+    return segment ? segment[index + SEGMENT_BASE - segmentSize(k)] : NULL;
+}
+
+
+axvector *axv_cvecFreeze(axv_cvec *cv) {
+    uint64_t len = atomic_load_explicit(&cv->len, memory_order_acquire);
+    axvector *v = axv_newWithAllocator(len, cv->allocator);
+    if (!v)
+        return NULL;
+    void **items = axv_data(v);
+    for (uint64_t i = 0; i < len;) {
+        unsigned k = segmentOf(i);
+        uint64_t m = MIN(len - i, segmentSize(k));
+        void **segment = atomic_load_explicit(&cv->segments[k], memory_order_relaxed);
+        if (segment)
+            memcpy(items + i, segment, m * sizeof *items);
+        else
+            memset(items + i, 0, m * sizeof *items);
+        i += m;
+    }
+    v->len = len;
+    freeSegments(cv);
+    return v;
+}
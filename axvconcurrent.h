@@ -0,0 +1,186 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVCONCURRENT_H
+#define AXVECTOR_AXVCONCURRENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "axvector.h"
+
+/*
+    axvconcurrent provides lock-free containers of void * items that may be used from multiple threads at once.
+
+    axv_spsc is a bounded ring buffer for exactly one producer thread and one consumer thread. Like an overlay, it
+    has a fixed capacity and can be laid over a caller-owned array of items. axv_mpmc is a bounded queue for any
+    number of producer and consumer threads. Both have a capacity that is a power of two. Both offer batch
+    operations which move whole runs of items and synchronise once per run instead of once per item.
+
+    axv_cvec is an unbounded append-only vector any number of threads may push to at once. Each push reserves its
+    slots with a single atomic increment. The items are stored in segments of growing size which, unlike the array of
+    an axvector, are never moved, so items already pushed stay where they are while others are pushed. Once all
+    threads are done pushing, axv_cvecFreeze() turns it into an ordinary axvector.
+
+    The structs are opaque, as their members are C11 atomics. Items still in a queue when it is destroyed are not
+    touched, there is no destructor.
+*/
+typedef struct axv_spsc axv_spsc;
+typedef struct axv_mpmc axv_mpmc;
+typedef struct axv_cvec axv_cvec;
+
+
+/**
+ * Create a single-producer/single-consumer queue.
+ * @param capacity Minimum capacity. Rounded up to the next power of two.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn().
+ * @return New queue or NULL if OOM.
+ */
+axv_spsc *axv_spscNew(uint64_t capacity, const axv_allocator *allocator);
+/**
+ * Create a single-producer/single-consumer queue using a caller-owned array as its ring buffer. Only the queue
+ * itself is allocated. The array is not freed upon destruction and must outlive the queue.
+ * @param items An array of capacity items of type void *.
+ * @param capacity Number of items in the array. Only the largest power of two not greater than this is used.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn().
+ * @return New queue or NULL if OOM or capacity is 0.
+ */
+axv_spsc *axv_spscNewOverlay(void **items, uint64_t capacity, const axv_allocator *allocator);
+/**
+ * Destroy queue and free memory. Must not be called while the queue is in use.
+ */
+void axv_spscDestroy(axv_spsc *q);
+/**
+ * Enqueue an item. May only be called by the producer.
+ * @param val Item.
+ * @return True iff the queue is full. Item is not enqueued in this case.
+ */
+bool axv_spscPush(axv_spsc *q, void *val);
+/**
+ * Dequeue an item. May only be called by the consumer.
+ * @param val Where to store the item.
+ * @return True iff the queue is empty. Nothing is stored in this case.
+ */
+bool axv_spscPop(axv_spsc *q, void **val);
+/**
+ * Enqueue as many items as fit, up to n, in order. May only be called by the producer.
+ * @param src Array of n items.
+ * @param n Number of items to enqueue.
+ * @return Number of items enqueued, the first ones of src.
+ */
+uint64_t axv_spscPushN(axv_spsc *q, void **src, uint64_t n);
+/**
+ * Dequeue up to n items in order. May only be called by the consumer.
+ * @param dst Array with room for n items.
+ * @param n Maximum number of items to dequeue.
+ * @return Number of items dequeued and stored at the beginning of dst.
+ */
+uint64_t axv_spscPopN(axv_spsc *q, void **dst, uint64_t n);
+/**
+ * Number of items in the queue. Only a snapshot if called while the queue is in use.
+ * @return Number of items.
+ */
+uint64_t axv_spscLen(axv_spsc *q);
+/**
+ * Capacity of the queue.
+ * @return Capacity.
+ */
+uint64_t axv_spscCap(axv_spsc *q);
+/**
+ * Create a multi-producer/multi-consumer queue. Every slot carries a sequence number next to its item, so unlike
+ * axv_spsc there is no overlay variant.
+ * @param capacity Minimum capacity. Rounded up to the next power of two.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn().
+ * @return New queue or NULL if OOM.
+ */
+axv_mpmc *axv_mpmcNew(uint64_t capacity, const axv_allocator *allocator);
+/**
+ * Destroy queue and free memory. Must not be called while the queue is in use.
+ */
+void axv_mpmcDestroy(axv_mpmc *q);
+/**
+ * Enqueue an item.
+ * @param val Item.
+ * @return True iff the queue is full. Item is not enqueued in this case.
+ */
+bool axv_mpmcPush(axv_mpmc *q, void *val);
+/**
+ * Dequeue an item.
+ * @param val Where to store the item.
+ * @return True iff the queue is empty. Nothing is stored in this case.
+ */
+bool axv_mpmcPop(axv_mpmc *q, void **val);
+/**
+ * Enqueue up to n items. The items enqueued by one call occupy consecutive positions in the queue, so they are
+ * dequeued in order and not interleaved with items of other producers.
+ * @param src Array of n items.
+ * @param n Number of items to enqueue.
+ * @return Number of items enqueued, the first ones of src. 0 only if the queue is full.
+ */
+uint64_t axv_mpmcPushN(axv_mpmc *q, void **src, uint64_t n);
+/**
+ * Dequeue up to n consecutive items in order.
+ * @param dst Array with room for n items.
+ * @param n Maximum number of items to dequeue.
+ * @return Number of items dequeued and stored at the beginning of dst. 0 only if the queue is empty.
+ */
+uint64_t axv_mpmcPopN(axv_mpmc *q, void **dst, uint64_t n);
+/**
+ * Capacity of the queue.
+ * @return Capacity.
+ */
+uint64_t axv_mpmcCap(axv_mpmc *q);
+/**
+ * Create an append-only concurrent vector. Memory for the first segment is allocated right away.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn(). Must be thread-safe.
+ * @return New concurrent vector or NULL if OOM.
+ */
+axv_cvec *axv_cvecNew(const axv_allocator *allocator);
+/**
+ * Destroy concurrent vector and free memory. Must not be called while the vector is in use.
+ */
+void axv_cvecDestroy(axv_cvec *cv);
+/**
+ * Push an item at the end of the vector. Lock-free unless a new segment has to be allocated.
+ * @param val Item.
+ * @return True iff OOM while allocating a segment. The slot reserved for the item is then left empty and reads as
+ * NULL in axv_cvecGet() and axv_cvecFreeze().
+ */
+bool axv_cvecPush(axv_cvec *cv, void *val);
+/**
+ * Push n items at the end of the vector. They occupy consecutive slots, not interleaved with items of other threads.
+ * @param src Array of n items.
+ * @param n Number of items to push.
+ * @return True iff OOM while allocating a segment. Slots whose segment could not be allocated are left empty.
+ */
+bool axv_cvecPushN(axv_cvec *cv, void **src, uint64_t n);
+/**
+ * Number of slots reserved so far. Only a snapshot if called while other threads are pushing, and it includes slots
+ * whose items are still being written.
+ * @return Number of slots.
+ */
+uint64_t axv_cvecLen(axv_cvec *cv);
+/**
+ * Get the item at some index. The item is only guaranteed to be visible if its push happened before this call, e.g.
+ * because the calling thread pushed it or joined with the thread that did.
+ * @param index Must be positive.
+ * @return Item at index or NULL if index out of range or the slot is empty.
+ */
+void *axv_cvecGet(axv_cvec *cv, uint64_t index);
+/**
+ * Flatten the concurrent vector into a new axvector using the same allocator and destroy the concurrent vector. All
+ * pushes must have returned before this is called.
+ * @return New axvector holding all items in slot order or NULL if OOM, in which case the concurrent vector is left
+ * intact.
+ */
+axvector *axv_cvecFreeze(axv_cvec *cv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AXVECTOR_AXVCONCURRENT_H
@@ -9,11 +9,57 @@
  */
 
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "axvector.h"
+#include "axvsort.h"
+#include <stdatomic.h>
 #include <string.h>
 
+#ifndef AXV_MMAP_THRESHOLD
+#define AXV_MMAP_THRESHOLD (64 << 20)
+#endif
+
+#if AXV_MMAP_THRESHOLD > 0 && (defined(__unix__) || defined(__APPLE__))
+#define AXV_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
+
+#if defined(AXV_NO_SIMD)
+#elif defined(__x86_64__) && defined(__GNUC__)
+#define AXV_X86_SIMD 1
+#include <immintrin.h>
+#ifdef AXV_NO_AVX512
+#define HAS_AVX512() 0
+#else
+#define HAS_AVX512() __builtin_cpu_supports("avx512f")
+#endif
+#elif defined(AXV_NEON) && defined(__aarch64__) && defined(__ARM_NEON)
+#define AXV_NEON_SIMD 1
+#include <arm_neon.h>
+#endif
+
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define DESTROY_BATCH 64
+#define ROTATE_BUFFER 64
+
+#ifndef AXV_INLINE_CAP
+#define AXV_INLINE_CAP 8
+#endif
+
+#ifndef AXV_BATCH
+#define AXV_BATCH 256
+#endif
 
 
 static void *(*malloc_)(size_t size) = malloc;
@@ -21,6 +67,149 @@ static void *(*realloc_)(void *ptr, size_t size) = realloc;
 static void (*free_)(void *ptr) = free;
 
 
+#ifdef AXV_MMAP
+/*
+    Blocks of at least AXV_MMAP_THRESHOLD bytes are mapped directly. A mapping reserves address space for four times
+    the requested size, but only the pages needed for the requested size are committed. Its first page holds the size
+    of the reservation, the block starts right after it. Growing within the reservation commits more pages, growing
+    beyond it moves the committed pages to a new reservation, so the items are never copied where mremap() is
+    available. Whether a block is mapped follows from its size, which the allocator functions are always given.
+*/
+static uint64_t roundToPages(uint64_t size) {
+    const uint64_t page = (uint64_t) sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+
+static void *mapBlock(size_t size) {
+    const uint64_t page = roundToPages(1);
+    const uint64_t reserved = 4 * roundToPages(size);
+    char *base = mmap(NULL, page + reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    if (mprotect(base, page + roundToPages(size), PROT_READ | PROT_WRITE) != 0) {
+        munmap(base, page + reserved);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(base, page + reserved, MADV_HUGEPAGE);
+#endif
+    *(uint64_t *) base = reserved;
+    return base + page;
+}
+
+
+static void unmapBlock(void *ptr) {
+    const uint64_t page = roundToPages(1);
+    char *base = (char *) ptr - page;
+    munmap(base, page + *(uint64_t *) base);
+}
+
+
+static void *remapBlock(void *ptr, size_t oldSize, size_t size) {
+    const uint64_t page = roundToPages(1);
+    const uint64_t committed = roundToPages(oldSize);
+    const uint64_t needed = roundToPages(size);
+    char *base = (char *) ptr - page;
+    const uint64_t reserved = *(uint64_t *) base;
+    if (needed <= reserved) {
+        if (needed > committed)
+            return mprotect(base + page + committed, needed - committed, PROT_READ | PROT_WRITE) ? NULL : ptr;
+        if (needed < committed) {
+            madvise(base + page + needed, committed - needed, MADV_DONTNEED);
+            mprotect(base + page + needed, committed - needed, PROT_NONE);
+        }
+        return ptr;
+    }
+    char *block = mapBlock(size);
+    if (!block)
+        return NULL;
+#ifdef MREMAP_FIXED
+    const uint64_t newReserved = *(uint64_t *) (block - page);
+    if (mremap(base, page + committed, page + committed, MREMAP_MAYMOVE | MREMAP_FIXED, block - page) != MAP_FAILED) {
+        *(uint64_t *) (block - page) = newReserved;
+        munmap(base + page + committed, reserved - committed);
+        return block;
+    }
+#endif
+    memcpy(block, ptr, oldSize);
+    unmapBlock(ptr);
+    return block;
+}
+#endif
+
+
+static void *defaultAlloc(size_t size, void *ctx) {
+    (void) ctx;
+#ifdef AXV_MMAP
+    if (size >= AXV_MMAP_THRESHOLD)
+        return mapBlock(size);
+#endif
+    return malloc_(size);
+}
+
+
+static void defaultFree(void *ptr, size_t size, void *ctx) {
+    (void) size; (void) ctx;
+#ifdef AXV_MMAP
+    if (size >= AXV_MMAP_THRESHOLD) {
+        unmapBlock(ptr);
+        return;
+    }
+#endif
+    free_(ptr);
+}
+
+
+static void *defaultRealloc(void *ptr, size_t oldSize, size_t size, void *ctx) {
+    (void) oldSize; (void) ctx;
+#ifdef AXV_MMAP
+    if (oldSize >= AXV_MMAP_THRESHOLD || size >= AXV_MMAP_THRESHOLD) {
+        if (oldSize >= AXV_MMAP_THRESHOLD && size >= AXV_MMAP_THRESHOLD)
+            return remapBlock(ptr, oldSize, size);
+        void *block = defaultAlloc(size, ctx);
+        if (!block)
+            return NULL;
+        memcpy(block, ptr, MIN(oldSize, size));
+        defaultFree(ptr, oldSize, ctx);
+        return block;
+    }
+#endif
+    return realloc_(ptr, size);
+}
+
+
+static const axv_allocator defaultAllocator = {defaultAlloc, defaultRealloc, defaultFree, NULL};
+
+
+/*
+    With AXV_STATS defined, the library counts what it does in global counters that are updated atomically, so
+    vectors may be used by several threads. Without it, STAT() expands to nothing and its arguments are not evaluated.
+*/
+#ifdef AXV_STATS
+static struct {
+    atomic_uint_fast64_t resizes;
+    atomic_uint_fast64_t reallocBytes;
+    atomic_uint_fast64_t movedBytes;
+    atomic_uint_fast64_t comparisons;
+    atomic_uint_fast64_t destructions;
+    atomic_uint_fast64_t maxCapacity;
+} stats;
+
+#define STAT(counter, n) atomic_fetch_add_explicit(&stats.counter, (n), memory_order_relaxed)
+
+
+static void statCapacity(uint64_t cap) {
+    uint_fast64_t max = atomic_load_explicit(&stats.maxCapacity, memory_order_relaxed);
+    while (cap > max && !atomic_compare_exchange_weak_explicit(&stats.maxCapacity, &max, cap, memory_order_relaxed,
+                                                               memory_order_relaxed));
+}
+#else
+#define STAT(counter, n) ((void) 0)
+#define statCapacity(cap) ((void) 0)
+#endif
+
+
 static uint64_t normaliseIndex(uint64_t len, int64_t index) {
     return index + (index < 0) * len;
 }
@@ -31,33 +220,782 @@ static uint64_t toItemSize(uint64_t n) {
 }
 
 
-static int defaultComparator(const void *a, const void *b) {
-    uintptr_t x = (uintptr_t) *(const void **) a;
-    uintptr_t y = (uintptr_t) *(const void **) b;
-    return (x > y) - (x < y);
+static uint64_t headerSize(void) {
+    return sizeof(axvector) + toItemSize(AXV_INLINE_CAP);
 }
 
 
-axvector *axv_newSized(uint64_t size) {
-    size = MAX(1, size);
-    axvector *v = malloc_(sizeof *v);
-    if (v)
-        v->items = malloc_(toItemSize(size));
-    if (!v || !v->items) {
-        free_(v);
-        return NULL;
+static void **inlineItems(axvector *v) {
+    return (void **) (v + 1);
+}
+
+
+static void moveItems(void **dst, void **src, uint64_t n) {
+    STAT(movedBytes, toItemSize(n));
+    memmove(dst, src, toItemSize(n));
+}
+
+
+static void copyItems(void **dst, void **src, uint64_t n) {
+    STAT(movedBytes, toItemSize(n));
+    memcpy(dst, src, toItemSize(n));
+}
+
+
+static void destroyItems(axvector *v, void **items, uint64_t n) {
+    if (v->destroyBatch || v->destroy)
+        STAT(destructions, n);
+    if (v->destroyBatch) {
+        if (n)
+            v->destroyBatch(items, n, v->context);
+    } else if (v->destroy) {
+        for (uint64_t i = 0; i < n; ++i)
+            v->destroy(items[i]);
     }
-    v->len = 0;
-    v->cap = size;
-    v->cmp = defaultComparator;
-    v->context = NULL;
+}
+
+
+static int callComparator(axvector *v, const void *a, const void *b) {
+    STAT(comparisons, 1);
+    return v->cmp(a, b);
+}
+
+
+AXV_DEFINE_SORT(sortAddresses, AXV_COMPARE_ADDRESSES(a, b))
+AXV_DEFINE_SORT(sortComparator, callComparator((axvector *) ctx, &a, &b))
+
+
+static void sortItems(axvector *v, void **items, uint64_t len) {
+    if (v->cmp == axv_compareAddress)
+        sortAddresses(items, len, NULL);
+    else
+        sortComparator(items, len, v);
+}
+
+
+void axv_sortItems_(axvector *v, void **items, uint64_t len) {
+    sortItems(v, items, len);
+}
+
+
+static int compareItems(axvector *v, void *a, void *b) {
+    return v->cmp == axv_compareAddress ? sortAddressesCmp_(a, b, NULL) : callComparator(v, &a, &b);
+}
+
+
+static void initFields(axvector *v, void **items, uint64_t len, uint64_t cap, const axv_allocator *allocator) {
+    v->items = items;
+    v->allocator = allocator ? allocator : &defaultAllocator;
+    v->len = len;
+    v->cap = cap;
+    v->head = 0;
+    v->cmp = axv_compareAddress;
     v->destroy = NULL;
+    v->destroyBatch = NULL;
+    v->hash = NULL;
+    v->index = NULL;
+    v->shared = NULL;
+    v->context = NULL;
+    v->grow = axv_growGeometric;
+    v->growParam = 200;
     v->locked = false;
     v->overlay = false;
+    v->inlined = false;
+    v->embedded = false;
+    v->autoShrink = false;
+    statCapacity(cap);
+}
+
+
+/*
+    The hash index is an open addressing table with linear probing. Each entry stands for all items comparing equal
+    to its item and records how many there are and the index of the first one. Entries with a count of 0 are empty.
+    Removed entries are filled by moving subsequent entries back, so there are no tombstones. Indices are stored
+    offset by base, which starts out large and is decreased by pushing and increased by popping at the front, so that
+    front operations update a single entry instead of every stored index.
+*/
+typedef struct indexEntry {
+    void *item;
+    uint64_t hash;
+    uint64_t first;
+    uint64_t count;
+} indexEntry;
+
+
+struct axv_index {
+    indexEntry *entries;
+    uint64_t mask;
+    uint64_t used;
+    uint64_t base;
+    bool stale;
+};
+
+
+static uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    return h;
+}
+
+
+static uint64_t indexBytes(struct axv_index *ix) {
+    return (ix->mask + 1) * sizeof *ix->entries;
+}
+
+
+static indexEntry *indexFind(axvector *v, struct axv_index *ix, void *item, uint64_t hash) {
+    for (uint64_t i = hash & ix->mask;; i = (i + 1) & ix->mask) {
+        indexEntry *e = ix->entries + i;
+        if (e->count == 0 || (e->hash == hash && compareItems(v, e->item, item) == 0))
+            return e;
+    }
+}
+
+
+static bool indexAlloc(axvector *v, struct axv_index *ix, uint64_t n) {
+    uint64_t size = 16;
+    while (size < n + n / 3 + 1)
+        size <<= 1;
+    indexEntry *entries = v->allocator->alloc(size * sizeof *entries, v->allocator->ctx);
+    if (!entries)
+        return true;
+    memset(entries, 0, size * sizeof *entries);
+    if (ix->entries)
+        v->allocator->free(ix->entries, indexBytes(ix), v->allocator->ctx);
+    ix->entries = entries;
+    ix->mask = size - 1;
+    ix->used = 0;
+    return false;
+}
+
+
+static bool indexGrow(axvector *v, struct axv_index *ix) {
+    struct axv_index old = *ix;
+    ix->entries = NULL;
+    if (indexAlloc(v, ix, 2 * old.used)) {
+        *ix = old;
+        return true;
+    }
+    for (uint64_t i = 0; i <= old.mask; ++i) {
+        if (old.entries[i].count == 0)
+            continue;
+        uint64_t j = old.entries[i].hash & ix->mask;
+        while (ix->entries[j].count)
+            j = (j + 1) & ix->mask;
+        ix->entries[j] = old.entries[i];
+    }
+    ix->used = old.used;
+    v->allocator->free(old.entries, indexBytes(&old), v->allocator->ctx);
+    return false;
+}
+
+
+// Count item at index in. Returns its entry or NULL if OOM.
+static indexEntry *indexAdd(axvector *v, struct axv_index *ix, void *item, uint64_t hash, uint64_t index) {
+    if ((ix->used + 1) * 4 > (ix->mask + 1) * 3 && indexGrow(v, ix))
+        return NULL;
+    indexEntry *e = indexFind(v, ix, item, hash);
+    if (e->count++ == 0) {
+        e->item = item;
+        e->hash = hash;
+        e->first = ix->base + index;
+        ++ix->used;
+    } else {
+        e->first = MIN(e->first, ix->base + index);
+    }
+    return e;
+}
+
+
+static void indexRemove(axvector *v, struct axv_index *ix, void *item, uint64_t index) {
+    indexEntry *e = indexFind(v, ix, item, mixHash(v->hash(item)));
+    if (e->count == 0) {
+        ix->stale = true;
+        return;
+    }
+    if (--e->count) {
+        // the next occurrence is unknown
+        if (e->first == ix->base + index)
+            ix->stale = true;
+        return;
+    }
+    uint64_t i = e - ix->entries;
+    for (uint64_t j = (i + 1) & ix->mask; ix->entries[j].count; j = (j + 1) & ix->mask) {
+        uint64_t home = ix->entries[j].hash & ix->mask;
+        if (((j - home) & ix->mask) >= ((j - i) & ix->mask)) {
+            ix->entries[i] = ix->entries[j];
+            i = j;
+        }
+    }
+    ix->entries[i].count = 0;
+    --ix->used;
+}
+
+
+static void freeIndex(axvector *v) {
+    if (!v->index)
+        return;
+    if (v->index->entries)
+        v->allocator->free(v->index->entries, indexBytes(v->index), v->allocator->ctx);
+    v->allocator->free(v->index, sizeof *v->index, v->allocator->ctx);
+    v->index = NULL;
+}
+
+
+static void invalidateIndex(axvector *v) {
+    if (v->index)
+        v->index->stale = true;
+}
+
+
+// Return the up-to-date index, building it if need be, or NULL if there is no hash function or OOM.
+static struct axv_index *validIndex(axvector *v) {
+    if (!v->hash)
+        return NULL;
+    if (!v->index) {
+        v->index = v->allocator->alloc(sizeof *v->index, v->allocator->ctx);
+        if (!v->index)
+            return NULL;
+        v->index->entries = NULL;
+        v->index->stale = true;
+    }
+    struct axv_index *ix = v->index;
+    if (!ix->stale)
+        return ix;
+    if (indexAlloc(v, ix, v->len)) {
+        freeIndex(v);
+        return NULL;
+    }
+    ix->base = UINT64_C(1) << 62;
+    for (uint64_t i = 0; i < v->len; ++i)
+        indexAdd(v, ix, v->items[i], mixHash(v->hash(v->items[i])), i);
+    ix->stale = false;
+    return ix;
+}
+
+
+void axv_indexPushed_(axvector *v) {
+    struct axv_index *ix = v->index;
+    void *item = v->items[v->len - 1];
+    if (!ix->stale && !indexAdd(v, ix, item, mixHash(v->hash(item)), v->len - 1))
+        ix->stale = true;
+}
+
+
+void axv_indexPopped_(axvector *v, void *val) {
+    if (!v->index->stale)
+        indexRemove(v, v->index, val, v->len);
+}
+
+
+void axv_indexPushedFront_(axvector *v) {
+    struct axv_index *ix = v->index;
+    void *item = v->items[0];
+    if (ix->stale)
+        return;
+    if (ix->base == 0) {
+        ix->stale = true;
+        return;
+    }
+    --ix->base;
+    if (!indexAdd(v, ix, item, mixHash(v->hash(item)), 0))
+        ix->stale = true;
+}
+
+
+void axv_indexPoppedFront_(axvector *v, void *val) {
+    struct axv_index *ix = v->index;
+    if (ix->stale)
+        return;
+    indexRemove(v, ix, val, 0);
+    ++ix->base;
+}
+
+
+void axv_indexSet_(axvector *v, uint64_t index, void *old) {
+    struct axv_index *ix = v->index;
+    void *item = v->items[index];
+    if (!ix->stale)
+        indexRemove(v, ix, old, index);
+    if (!ix->stale && !indexAdd(v, ix, item, mixHash(v->hash(item)), index))
+        ix->stale = true;
+}
+
+
+/*
+    An internal array shared by snapshots. It is freed by the last vector releasing it. A vector writing to its items
+    first gets an array of its own, so a shared array is never written to and may be read by several threads.
+*/
+struct axv_share {
+    atomic_uint_fast64_t refs;
+    void **base;
+    uint64_t size;
+};
+
+
+static void releaseShare(axvector *v) {
+    struct axv_share *share = v->shared;
+    v->shared = NULL;
+    if (atomic_fetch_sub_explicit(&share->refs, 1, memory_order_acq_rel) == 1) {
+        v->allocator->free(share->base, toItemSize(share->size), v->allocator->ctx);
+        v->allocator->free(share, sizeof *share, v->allocator->ctx);
+    }
+}
+
+
+/*
+    Give a shared vector an array of its own with head free slots in front of cap slots, or take over the shared array
+    if no other vector references it anymore.
+*/
+static bool ownStorage(axvector *v, uint64_t head, uint64_t cap) {
+    struct axv_share *share = v->shared;
+    if (atomic_load_explicit(&share->refs, memory_order_acquire) == 1) {
+        v->allocator->free(share, sizeof *share, v->allocator->ctx);
+        v->shared = NULL;
+        return false;
+    }
+    void **base = v->allocator->alloc(toItemSize(head + cap), v->allocator->ctx);
+    if (!base)
+        return true;
+    copyItems(base + head, v->items, MIN(v->len, cap));
+    releaseShare(v);
+    v->items = base + head;
+    v->head = head;
+    v->cap = cap;
+    return false;
+}
+
+
+static bool unshare(axvector *v) {
+    return v->shared && ownStorage(v, v->head, v->cap);
+}
+
+
+bool axv_unshare(axvector *v) {
+    return unshare(v);
+}
+
+
+/*
+    Kernels for the default comparator. Items are then compared as unsigned integers, which is done several items at
+    a time using AVX-512, AVX2 or NEON, chosen at runtime on x86-64. The scalar versions handle the remaining items
+    and all other platforms. Defining AXV_NO_AVX512 or AXV_NO_SIMD at compile time restricts x86-64 to AVX2 or all
+    platforms to the scalar versions, which lets the tests run every kernel on one machine. The NEON kernels have not
+    been run by the tests yet and are only used if AXV_NEON is defined, e.g. by configuring with -DAXV_NEON=ON.
+*/
+static int64_t searchScalar(void **items, uint64_t n, void *val) {
+    for (uint64_t i = 0; i < n; ++i) {
+        if (items[i] == val)
+            return (int64_t) i;
+    }
+    return -1;
+}
+
+
+static uint64_t countScalar(void **items, uint64_t n, void *val) {
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < n; ++i)
+        count += items[i] == val;
+    return count;
+}
+
+
+static uintptr_t maxScalar(void **items, uint64_t n, uintptr_t max) {
+    for (uint64_t i = 0; i < n; ++i)
+        max = MAX(max, (uintptr_t) items[i]);
+    return max;
+}
+
+
+static uintptr_t minScalar(void **items, uint64_t n, uintptr_t min) {
+    for (uint64_t i = 0; i < n; ++i)
+        min = MIN(min, (uintptr_t) items[i]);
+    return min;
+}
+
+
+static void reverseScalar(void **items, uint64_t n) {
+    for (uint64_t i = 0; i < n / 2; ++i) {
+        void *tmp = items[i];
+        items[i] = items[n - 1 - i];
+        items[n - 1 - i] = tmp;
+    }
+}
+
+
+static void reverseCopyScalar(void **dst, void **src, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+}
+
+
+#ifdef AXV_X86_SIMD
+__attribute__((target("avx512f")))
+static void reverseAVX512(void **items, uint64_t n) {
+    const __m512i order = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    void **l = items;
+    void **r = items + n;
+    for (; r - l >= 16; l += 8) {
+        r -= 8;
+        __m512i a = _mm512_loadu_si512(l);
+        __m512i b = _mm512_loadu_si512(r);
+        _mm512_storeu_si512(l, _mm512_permutexvar_epi64(order, b));
+        _mm512_storeu_si512(r, _mm512_permutexvar_epi64(order, a));
+    }
+    reverseScalar(l, r - l);
+}
+
+
+__attribute__((target("avx512f")))
+static void reverseCopyAVX512(void **dst, void **src, uint64_t n) {
+    const __m512i order = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm512_storeu_si512(dst + i, _mm512_permutexvar_epi64(order, _mm512_loadu_si512(src + n - i - 8)));
+    reverseCopyScalar(dst + i, src, n - i);
+}
+
+
+__attribute__((target("avx512f")))
+static int64_t searchAVX512(void **items, uint64_t n, void *val) {
+    const __m512i needle = _mm512_set1_epi64((int64_t) (uintptr_t) val);
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 mask = _mm512_cmpeq_epu64_mask(_mm512_loadu_si512(items + i), needle);
+        if (mask)
+            return (int64_t) (i + __builtin_ctz(mask));
+    }
+    int64_t found = searchScalar(items + i, n - i, val);
+    return found < 0 ? -1 : (int64_t) i + found;
+}
+
+
+__attribute__((target("avx512f")))
+static uint64_t countAVX512(void **items, uint64_t n, void *val) {
+    const __m512i needle = _mm512_set1_epi64((int64_t) (uintptr_t) val);
+    uint64_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8)
+        count += __builtin_popcount(_mm512_cmpeq_epu64_mask(_mm512_loadu_si512(items + i), needle));
+    return count + countScalar(items + i, n - i, val);
+}
+
+
+__attribute__((target("avx512f")))
+static uintptr_t maxAVX512(void **items, uint64_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm512_max_epu64(acc, _mm512_loadu_si512(items + i));
+    return maxScalar(items + i, n - i, _mm512_reduce_max_epu64(acc));
+}
+
+
+__attribute__((target("avx512f")))
+static uintptr_t minAVX512(void **items, uint64_t n) {
+    __m512i acc = _mm512_set1_epi64(-1);
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm512_min_epu64(acc, _mm512_loadu_si512(items + i));
+    return minScalar(items + i, n - i, _mm512_reduce_min_epu64(acc));
+}
+
+
+__attribute__((target("avx2")))
+static int64_t searchAVX2(void **items, uint64_t n, void *val) {
+    const __m256i needle = _mm256_set1_epi64x((int64_t) (uintptr_t) val);
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lo = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (items + i)), needle);
+        __m256i hi = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (items + i + 4)), needle);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lo)) | _mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4;
+        if (mask)
+            return (int64_t) (i + __builtin_ctz(mask));
+    }
+    int64_t found = searchScalar(items + i, n - i, val);
+    return found < 0 ? -1 : (int64_t) i + found;
+}
+
+
+__attribute__((target("avx2")))
+static uint64_t countAVX2(void **items, uint64_t n, void *val) {
+    const __m256i needle = _mm256_set1_epi64x((int64_t) (uintptr_t) val);
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_sub_epi64(acc, _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (items + i)), needle));
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + countScalar(items + i, n - i, val);
+}
+
+
+__attribute__((target("avx2")))
+static void reverseAVX2(void **items, uint64_t n) {
+    void **l = items;
+    void **r = items + n;
+    for (; r - l >= 8; l += 4) {
+        r -= 4;
+        __m256i a = _mm256_loadu_si256((const __m256i *) l);
+        __m256i b = _mm256_loadu_si256((const __m256i *) r);
+        _mm256_storeu_si256((__m256i *) l, _mm256_permute4x64_epi64(b, 0x1b));
+        _mm256_storeu_si256((__m256i *) r, _mm256_permute4x64_epi64(a, 0x1b));
+    }
+    reverseScalar(l, r - l);
+}
+
+
+__attribute__((target("avx2")))
+static void reverseCopyAVX2(void **dst, void **src, uint64_t n) {
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (src + n - i - 4));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_permute4x64_epi64(x, 0x1b));
+    }
+    reverseCopyScalar(dst + i, src, n - i);
+}
+
+
+/* AVX2 only compares signed 64-bit integers, so the sign bit is flipped to compare unsigned ones. */
+__attribute__((target("avx2")))
+static uintptr_t extremeAVX2(void **items, uint64_t n, bool max) {
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    __m256i acc = _mm256_set1_epi64x(max ? INT64_MIN : INT64_MAX);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (items + i)), sign);
+        acc = _mm256_blendv_epi8(acc, x, max ? _mm256_cmpgt_epi64(x, acc) : _mm256_cmpgt_epi64(acc, x));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, _mm256_xor_si256(acc, sign));
+    uintptr_t result = lanes[0];
+    for (unsigned l = 1; l < 4; ++l)
+        result = max ? MAX(result, lanes[l]) : MIN(result, lanes[l]);
+    return max ? maxScalar(items + i, n - i, result) : minScalar(items + i, n - i, result);
+}
+#endif
+
+
+#ifdef AXV_NEON_SIMD
+static void reverseNEON(void **items, uint64_t n) {
+    void **l = items;
+    void **r = items + n;
+    for (; r - l >= 4; l += 2) {
+        r -= 2;
+        uint64x2_t a = vld1q_u64((const uint64_t *) l);
+        uint64x2_t b = vld1q_u64((const uint64_t *) r);
+        vst1q_u64((uint64_t *) l, vextq_u64(b, b, 1));
+        vst1q_u64((uint64_t *) r, vextq_u64(a, a, 1));
+    }
+    reverseScalar(l, r - l);
+}
+
+
+static void reverseCopyNEON(void **dst, void **src, uint64_t n) {
+    uint64_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t x = vld1q_u64((const uint64_t *) (src + n - i - 2));
+        vst1q_u64((uint64_t *) (dst + i), vextq_u64(x, x, 1));
+    }
+    reverseCopyScalar(dst + i, src, n - i);
+}
+
+
+static int64_t searchNEON(void **items, uint64_t n, void *val) {
+    const uint64x2_t needle = vdupq_n_u64((uint64_t) (uintptr_t) val);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint64x2_t lo = vceqq_u64(vld1q_u64((const uint64_t *) (items + i)), needle);
+        uint64x2_t hi = vceqq_u64(vld1q_u64((const uint64_t *) (items + i + 2)), needle);
+        if (vmaxvq_u32(vreinterpretq_u32_u64(vorrq_u64(lo, hi))))
+            break;
+    }
+    int64_t found = searchScalar(items + i, n - i, val);
+    return found < 0 ? -1 : (int64_t) i + found;
+}
+
+
+static uint64_t countNEON(void **items, uint64_t n, void *val) {
+    const uint64x2_t needle = vdupq_n_u64((uint64_t) (uintptr_t) val);
+    uint64x2_t acc = vdupq_n_u64(0);
+    uint64_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        acc = vsubq_u64(acc, vceqq_u64(vld1q_u64((const uint64_t *) (items + i)), needle));
+    return vaddvq_u64(acc) + countScalar(items + i, n - i, val);
+}
+
+
+static uintptr_t extremeNEON(void **items, uint64_t n, bool max) {
+    uint64x2_t acc = vdupq_n_u64(max ? 0 : UINT64_MAX);
+    uint64_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t x = vld1q_u64((const uint64_t *) (items + i));
+        acc = vbslq_u64(max ? vcgtq_u64(x, acc) : vcltq_u64(x, acc), x, acc);
+    }
+    uintptr_t a = vgetq_lane_u64(acc, 0), b = vgetq_lane_u64(acc, 1);
+    return max ? maxScalar(items + i, n - i, MAX(a, b)) : minScalar(items + i, n - i, MIN(a, b));
+}
+#endif
+
+
+static void reverseItems(void **items, uint64_t n) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        reverseAVX512(items, n);
+    else if (__builtin_cpu_supports("avx2"))
+        reverseAVX2(items, n);
+    else
+        reverseScalar(items, n);
+#elif defined(AXV_NEON_SIMD)
+    reverseNEON(items, n);
+#else
+    reverseScalar(items, n);
+#endif
+}
+
+
+// store the n items at src to dst in reverse order, src and dst not overlapping
+static void reverseCopyItems(void **dst, void **src, uint64_t n) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        reverseCopyAVX512(dst, src, n);
+    else if (__builtin_cpu_supports("avx2"))
+        reverseCopyAVX2(dst, src, n);
+    else
+        reverseCopyScalar(dst, src, n);
+#elif defined(AXV_NEON_SIMD)
+    reverseCopyNEON(dst, src, n);
+#else
+    reverseCopyScalar(dst, src, n);
+#endif
+}
+
+
+// swap the n items at a with those at b, the two ranges not overlapping
+static void swapItems(void **a, void **b, uint64_t n) {
+    void *tmp[ROTATE_BUFFER];
+    STAT(movedBytes, 2 * toItemSize(n));
+    while (n > 0) {
+        const uint64_t m = MIN(n, ROTATE_BUFFER);
+        memcpy(tmp, a, toItemSize(m));
+        memcpy(a, b, toItemSize(m));
+        memcpy(b, tmp, toItemSize(m));
+        a += m;
+        b += m;
+        n -= m;
+    }
+}
+
+
+/*
+    Exchanges the left items at items with the right items following them. If the shorter part fits into the stack
+    buffer, it is set aside while the longer one is moved in a single memmove(). Otherwise, the shorter part is swapped
+    with the far end of the longer one, which puts it in place and leaves a smaller rotation of the rest (Gries-Mills
+    block swap). Either way, every item is moved about once instead of twice by three reversals.
+*/
+static void rotateItems(void **items, uint64_t left, uint64_t right) {
+    void *tmp[ROTATE_BUFFER];
+    while (left > 0 && right > 0) {
+        if (right <= ROTATE_BUFFER && right <= left) {
+            memcpy(tmp, items + left, toItemSize(right));
+            moveItems(items + right, items, left);
+            memcpy(items, tmp, toItemSize(right));
+            STAT(movedBytes, 2 * toItemSize(right));
+            return;
+        }
+        if (left <= ROTATE_BUFFER) {
+            memcpy(tmp, items, toItemSize(left));
+            moveItems(items, items + left, right);
+            memcpy(items + right, tmp, toItemSize(left));
+            STAT(movedBytes, 2 * toItemSize(left));
+            return;
+        }
+        if (left <= right) {
+            swapItems(items, items + right, left);
+            right -= left;
+        } else {
+            swapItems(items, items + left, right);
+            items += right;
+            left -= right;
+        }
+    }
+}
+
+
+static int64_t searchAddress(void **items, uint64_t n, void *val) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        return searchAVX512(items, n, val);
+    if (__builtin_cpu_supports("avx2"))
+        return searchAVX2(items, n, val);
+#elif defined(AXV_NEON_SIMD)
+    return searchNEON(items, n, val);
+#endif
+    return searchScalar(items, n, val);
+}
+
+
+static uint64_t countAddress(void **items, uint64_t n, void *val) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        return countAVX512(items, n, val);
+    if (__builtin_cpu_supports("avx2"))
+        return countAVX2(items, n, val);
+#elif defined(AXV_NEON_SIMD)
+    return countNEON(items, n, val);
+#endif
+    return countScalar(items, n, val);
+}
+
+
+static uintptr_t maxAddress(void **items, uint64_t n) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        return maxAVX512(items, n);
+    if (__builtin_cpu_supports("avx2"))
+        return extremeAVX2(items, n, true);
+#elif defined(AXV_NEON_SIMD)
+    return extremeNEON(items, n, true);
+#endif
+    return maxScalar(items, n, 0);
+}
+
+
+static uintptr_t minAddress(void **items, uint64_t n) {
+#if defined(AXV_X86_SIMD)
+    if (HAS_AVX512())
+        return minAVX512(items, n);
+    if (__builtin_cpu_supports("avx2"))
+        return extremeAVX2(items, n, false);
+#elif defined(AXV_NEON_SIMD)
+    return extremeNEON(items, n, false);
+#endif
+    return minScalar(items, n, UINTPTR_MAX);
+}
+
+
+axvector *axv_newWithAllocator(uint64_t size, const axv_allocator *allocator) {
+    allocator = allocator ? allocator : &defaultAllocator;
+    size = MAX(1, size);
+    axvector *v = allocator->alloc(headerSize(), allocator->ctx);
+    if (!v)
+        return NULL;
+    void **items = size <= AXV_INLINE_CAP ? inlineItems(v) : allocator->alloc(toItemSize(size), allocator->ctx);
+    if (!items) {
+        allocator->free(v, headerSize(), allocator->ctx);
+        return NULL;
+    }
+    initFields(v, items, 0, size, allocator);
+    v->inlined = items == inlineItems(v);
     return v;
 }
 
 
+axvector *axv_newSized(uint64_t size) {
+    return axv_newWithAllocator(size, NULL);
+}
+
+
 axvector *axv_new(void) {
     return axv_newSized(7);
 }
@@ -65,37 +1003,63 @@ axvector *axv_new(void) {
 
 axvector axv_newOverlay(void **items, uint64_t length, uint64_t capacity) {
     axvector v;
-    length = MIN(length, capacity);
-    v.items = items;
-    v.len = length;
-    v.cap = capacity;
-    v.cmp = NULL;
-    v.destroy = NULL;
-    v.context = NULL;
+    initFields(&v, items, MIN(length, capacity), capacity, NULL);
     v.locked = true;
     v.overlay = true;
+    v.embedded = true;
     return v;
 }
 
 
+bool axv_initWithAllocator(axvector *v, uint64_t size, const axv_allocator *allocator) {
+    allocator = allocator ? allocator : &defaultAllocator;
+    size = MAX(1, size);
+    void **items = allocator->alloc(toItemSize(size), allocator->ctx);
+    if (!items)
+        return true;
+    initFields(v, items, 0, size, allocator);
+    v->embedded = true;
+    return false;
+}
+
+
+bool axv_init(axvector *v, uint64_t size) {
+    return axv_initWithAllocator(v, size, NULL);
+}
+
+
+void axv_initBuffer(axvector *v, void **buffer, uint64_t capacity) {
+    initFields(v, buffer, 0, capacity, NULL);
+    v->overlay = true;
+    v->embedded = true;
+}
+
+
+void *axv_deinit(axvector *v) {
+    destroyItems(v, v->items, v->len);
+    freeIndex(v);
+    v->len = 0;
+    if (v->shared)
+        releaseShare(v);
+    else if (!v->overlay && !v->inlined)
+        v->allocator->free(v->items - v->head, toItemSize(v->head + v->cap), v->allocator->ctx);
+    return v->context;
+}
+
+
 void *axv_destroy(axvector *v) {
-    if (v->destroy) {
-        while (v->len)
-            v->destroy(v->items[--v->len]);
-    }
-    void *context = v->context;
-    if (!v->overlay) {
-        free_(v->items);
-        free_(v);
-    }
+    void *context = axv_deinit(v);
+    if (!v->embedded)
+        v->allocator->free(v, headerSize(), v->allocator->ctx);
     return context;
 }
 
 
 bool axv_swap(axvector *v, int64_t index1, int64_t index2) {
+    invalidateIndex(v);
     uint64_t i1 = normaliseIndex(v->len, index1);
     uint64_t i2 = normaliseIndex(v->len, index2);
-    if (i1 >= v->len || i2 >= v->len)
+    if (i1 >= v->len || i2 >= v->len || unshare(v))
         return true;
     void *tmp = v->items[i1];
     v->items[i1] = v->items[i2];
@@ -105,102 +1069,191 @@ bool axv_swap(axvector *v, int64_t index1, int64_t index2) {
 
 
 axvector *axv_reverse(axvector *v) {
-    void **l = v->items;
-    void **r = v->items + v->len - 1;
-    while (l < r) {
-        void *tmp = *l;
-        *l = *r;
-        *r = tmp;
-        ++l; --r;
-    }
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    reverseItems(v->items, v->len);
     return v;
 }
 
 
 bool axv_reverseSection(axvector *v, int64_t index1, int64_t index2) {
+    invalidateIndex(v);
     uint64_t i1 = normaliseIndex(v->len, index1);
     uint64_t i2 = normaliseIndex(v->len, index2);
-    if (i1 >= v->len || i2 > v->len)
+    if (i1 >= v->len || i2 > v->len || unshare(v))
         return true;
-    void **l = v->items + i1;
-    void **r = v->items + i2 - 1;
-    while (l < r) {
-        void *tmp = *l;
-        *l = *r;
-        *r = tmp;
-        ++l; --r;
-    }
+    if (i2 > i1)
+        reverseItems(v->items + i1, i2 - i1);
     return false;
 }
 
 
 axvector *axv_rotate(axvector *v, int64_t k) {
+    if (v->len == 0)
+        return v;
     k %= axv_len(v);
     if (k == 0)
         return v;
-    axv_reverse(v);
-    axv_reverseSection(v, 0, k);
-    axv_reverseSection(v, k, axv_len(v));
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    const uint64_t right = k > 0 ? (uint64_t) k : v->len + k;
+    rotateItems(v->items, v->len - right, right);
     return v;
 }
 
 
 bool axv_shift(axvector *v, int64_t index, int64_t n) {
+    uint64_t i = normaliseIndex(v->len, index);
+    if (i > v->len)
+        return true;
     if (n == 0)
         return false;
+    if (n > 0 && (axv_reserve(v, v->len + n) || unshare(v)))
+        return true;
+    if (n < 0 && i > 0 && unshare(v))
+        return true;
+    invalidateIndex(v);
     if (n > 0) {
-        const uint64_t oldlen = v->len;
-        if (v->len + n > v->cap && axv_resize(v, v->len + n))
-            return true;
-        memmove(v->items + index + n, v->items + index, toItemSize(oldlen - n - 1));
-        memset(v->items + index, 0, toItemSize(n));
-        if (oldlen == v->len)
-            v->len += n;
+        moveItems(v->items + i + n, v->items + i, v->len - i);
+        memset(v->items + i, 0, toItemSize(n));
+        v->len += n;
     } else {
-        n = MIN(-n, axv_len(v) - index);
-        if (v->destroy) {
-            for (int64_t i = index; i < index + n; ++i)
-                v->destroy(v->items[i]);
+        uint64_t m = MIN((uint64_t) -n, v->len - i);
+        destroyItems(v, v->items + i, m);
+        if (i == 0) {
+            v->items += m;
+            v->head += m;
+            v->cap -= m;
+        } else {
+            moveItems(v->items + i, v->items + i + m, v->len - i - m);
         }
-        memmove(v->items + index, v->items + index + n, toItemSize(v->len - index - n));
-        v->len -= n;
+        v->len -= m;
     }
     return false;
 }
 
 
+bool axv_pushN(axvector *v, void **src, uint64_t n) {
+    invalidateIndex(v);
+    if (axv_reserve(v, v->len + n) || unshare(v))
+        return true;
+    copyItems(v->items + v->len, src, n);
+    v->len += n;
+    return false;
+}
+
+
+bool axv_insertN(axvector *v, int64_t index, void **src, uint64_t n) {
+    invalidateIndex(v);
+    uint64_t i = normaliseIndex(v->len, index);
+    if (i > v->len || axv_reserve(v, v->len + n) || unshare(v))
+        return true;
+    moveItems(v->items + i + n, v->items + i, v->len - i);
+    copyItems(v->items + i, src, n);
+    v->len += n;
+    return false;
+}
+
+
+bool axv_eraseRange(axvector *v, int64_t index1, int64_t index2) {
+    uint64_t i1 = normaliseIndex(v->len, index1);
+    uint64_t i2 = normaliseIndex(v->len, index2);
+    if (i1 > i2 || i2 > v->len || unshare(v))
+        return true;
+    invalidateIndex(v);
+    destroyItems(v, v->items + i1, i2 - i1);
+    moveItems(v->items + i1, v->items + i2, v->len - i2);
+    v->len -= i2 - i1;
+    return false;
+}
+
+
+static void shrink(axvector *v) {
+    const uint64_t total = v->head + v->cap;
+    if (v->autoShrink && v->len < total / 4 && total > AXV_INLINE_CAP && !v->locked && !v->overlay)
+        axv_resize(v, MAX(2 * v->len, AXV_INLINE_CAP));
+}
+
+
+void axv_autoShrink_(axvector *v) {
+    shrink(v);
+}
+
+
+void axv_destroyItems_(axvector *v, void **items, uint64_t n) {
+    destroyItems(v, items, n);
+}
+
+
 axvector *axv_discard(axvector *v, uint64_t n) {
-    n = v->len - MIN(v->len, n);
-    if (v->destroy) {
-        while (v->len > n)
-            v->destroy(v->items[--v->len]);
-    } else {
-        v->len = n;
-    }
+    invalidateIndex(v);
+    n = MIN(v->len, n);
+    destroyItems(v, v->items + v->len - n, n);
+    v->len -= n;
+    shrink(v);
     return v;
 }
 
 
 axvector *axv_clear(axvector *v) {
-    if (v->destroy) {
-        while (v->len)
-            v->destroy(v->items[--v->len]);
-    }
+    invalidateIndex(v);
+    destroyItems(v, v->items, v->len);
     v->len = 0;
+    shrink(v);
     return v;
 }
 
 
 axvector *axv_copy(axvector *v) {
-    axvector *v2 = axv_newSized(v->cap);
+    axvector *v2 = axv_newWithAllocator(v->cap, v->allocator);
     if (!v2)
         return NULL;
 
-    memcpy(v2->items, v->items, toItemSize(v->len));
+    copyItems(v2->items, v->items, v->len);
     v2->len = v->len;
     v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
     v2->context = v->context;
     v2->destroy = NULL;
+    v2->destroyBatch = NULL;
+    return v2;
+}
+
+
+axvector *axv_snapshot(axvector *v) {
+    if (v->inlined || v->overlay)
+        return axv_copy(v);
+    const axv_allocator *allocator = v->allocator;
+    axvector *v2 = allocator->alloc(headerSize(), allocator->ctx);
+    if (!v2)
+        return NULL;
+    if (!v->shared) {
+        struct axv_share *share = allocator->alloc(sizeof *share, allocator->ctx);
+        if (!share) {
+            allocator->free(v2, headerSize(), allocator->ctx);
+            return NULL;
+        }
+        atomic_init(&share->refs, 1);
+        share->base = v->items - v->head;
+        share->size = v->head + v->cap;
+        v->shared = share;
+    }
+    atomic_fetch_add_explicit(&v->shared->refs, 1, memory_order_relaxed);
+
+    initFields(v2, v->items, v->len, v->cap, allocator);
+    v2->head = v->head;
+    v2->shared = v->shared;
+    v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
+    v2->context = v->context;
     return v2;
 }
 
@@ -209,9 +1262,11 @@ bool axv_extend(axvector *v1, axvector *v2) {
     if (v1 == v2)
         return false;
     const uint64_t extlen = v1->len + v2->len;
-    if (extlen > v1->cap && axv_resize(v1, extlen))
+    if (axv_reserve(v1, extlen) || unshare(v1))
         return true;
-    memcpy(v1->items + v1->len, v2->items, toItemSize(v2->len));
+    invalidateIndex(v1);
+    invalidateIndex(v2);
+    copyItems(v1->items + v1->len, v2->items, v2->len);
     v1->len = extlen;
     v2->len = 0;
     return false;
@@ -219,68 +1274,254 @@ bool axv_extend(axvector *v1, axvector *v2) {
 
 
 bool axv_concat(axvector *v1, axvector *v2) {
+    invalidateIndex(v1);
     const uint64_t extlen = v1->len + v2->len;
-    if (extlen > v1->cap && axv_resize(v1, extlen))
+    if (axv_reserve(v1, extlen) || unshare(v1))
         return true;
-    memcpy(v1->items + v1->len, v2->items, toItemSize(v2->len));
+    copyItems(v1->items + v1->len, v2->items, v2->len);
     v1->len = extlen;
     return false;
 }
 
 
-axvector *axv_slice(axvector *v, int64_t index1, int64_t index2) {
-    int64_t i1 = index1 + (index1 < 0) * axv_len(v);
-    int64_t i2 = index2 + (index2 < 0) * axv_len(v);
-    i1 = MAX(0, i1); i1 = MIN(i1, axv_len(v));
-    i2 = MAX(0, i2); i2 = MIN(i2, axv_len(v));
-
-    axvector *v2 = axv_newSized(v->len);
-    if (!v2)
-        return NULL;
-    memcpy(v2->items, v->items + i1, toItemSize(i2 - i1));
-    v2->len = i2 - i1;
-    v2->cmp = v->cmp;
-    v2->context = v->context;
-    v2->destroy = NULL;
-    return v2;
+static void sliceBounds(axvector *v, int64_t index1, int64_t index2, int64_t *i1, int64_t *i2) {
+    *i1 = index1 + (index1 < 0) * axv_len(v);
+    *i2 = index2 + (index2 < 0) * axv_len(v);
+    *i1 = MAX(0, *i1); *i1 = MIN(*i1, axv_len(v));
+    *i2 = MAX(*i1, *i2); *i2 = MIN(*i2, axv_len(v));
+}
+
+
+axvector *axv_slice(axvector *v, int64_t index1, int64_t index2) {
+    int64_t i1, i2;
+    sliceBounds(v, index1, index2, &i1, &i2);
+
+    axvector *v2 = axv_newWithAllocator(i2 - i1, v->allocator);
+    if (!v2)
+        return NULL;
+    copyItems(v2->items, v->items + i1, i2 - i1);
+    v2->len = i2 - i1;
+    v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
+    v2->context = v->context;
+    v2->destroy = NULL;
+    v2->destroyBatch = NULL;
+    return v2;
+}
+
+
+axvector *axv_rslice(axvector *v, int64_t index1, int64_t index2) {
+    int64_t i1, i2;
+    sliceBounds(v, index1, index2, &i1, &i2);
+
+    axvector *v2 = axv_newWithAllocator(i2 - i1, v->allocator);
+    if (!v2)
+        return NULL;
+    reverseCopyItems(v2->items, v->items + i1, i2 - i1);
+    v2->len = i2 - i1;
+    v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
+    v2->context = v->context;
+    v2->destroy = NULL;
+    v2->destroyBatch = NULL;
+    return v2;
+}
+
+
+axvector axv_view(axvector *v, int64_t index1, int64_t index2) {
+    int64_t i1, i2;
+    sliceBounds(v, index1, index2, &i1, &i2);
+    if (unshare(v))
+        i2 = i1;
+    axvector view = axv_newOverlay(v->items + i1, i2 - i1, i2 - i1);
+    view.cmp = v->cmp;
+    view.context = v->context;
+    return view;
+}
+
+
+axview axv_stridedView(axvector *v, int64_t index1, int64_t index2, int64_t stride) {
+    int64_t i1, i2;
+    sliceBounds(v, index1, index2, &i1, &i2);
+    axview view;
+    const uint64_t step = stride < 0 ? -(uint64_t) stride : (uint64_t) stride;
+    view.len = stride ? (i2 - i1 + step - 1) / step : 0;
+    view.base = v->items + (stride < 0 && view.len ? i2 - 1 : i1);
+    view.stride = stride;
+    view.cmp = v->cmp;
+    return view;
+}
+
+
+axview axv_rview(axvector *v, int64_t index1, int64_t index2) {
+    return axv_stridedView(v, index1, index2, -1);
+}
+
+
+bool axv_viewAny(axview *w, bool (*f)(const void *, void *), void *arg) {
+    for (uint64_t i = 0; i < w->len; ++i) {
+        if (f(w->base[(int64_t) i * w->stride], arg))
+            return true;
+    }
+    return false;
+}
+
+
+bool axv_viewAll(axview *w, bool (*f)(const void *, void *), void *arg) {
+    for (uint64_t i = 0; i < w->len; ++i) {
+        if (!f(w->base[(int64_t) i * w->stride], arg))
+            return false;
+    }
+    return true;
+}
+
+
+uint64_t axv_viewCount(axview *w, void *val) {
+    uint64_t n = 0;
+    STAT(comparisons, w->len);
+    for (uint64_t i = 0; i < w->len; ++i)
+        n += w->cmp(&val, w->base + (int64_t) i * w->stride) == 0;
+    return n;
+}
+
+
+axview *axv_viewForeach(axview *w, bool (*f)(void *, void *), void *arg) {
+    for (uint64_t i = 0; i < w->len; ++i) {
+        if (!f(w->base[(int64_t) i * w->stride], arg))
+            return w;
+    }
+    return w;
+}
+
+
+bool axv_resize(axvector *v, uint64_t size) {
+    if (v->locked)
+        return true;
+    if (size < v->len) {
+        invalidateIndex(v);
+        destroyItems(v, v->items + size, v->len - size);
+        v->len = size;
+    }
+    size = MAX(1, size);
+    if (v->shared) {
+        void **shared = v->items;
+        if (ownStorage(v, 0, size))
+            return true;
+        if (v->items != shared) {
+            // the items were copied to an array of their own with the new size
+            STAT(resizes, 1);
+            statCapacity(size);
+            return false;
+        }
+    }
+    const axv_allocator *allocator = v->allocator;
+    void **base = v->items - v->head;
+    uint64_t total = v->head + v->cap;
+    void **items;
+    if (size <= AXV_INLINE_CAP && !v->embedded) {
+        items = inlineItems(v);
+        STAT(reallocBytes, toItemSize(v->len));
+        memmove(items, v->items, toItemSize(v->len));
+        if (!v->inlined && !v->overlay)
+            allocator->free(base, toItemSize(total), allocator->ctx);
+    } else if (v->inlined || v->overlay) {
+        items = allocator->alloc(toItemSize(size), allocator->ctx);
+        if (!items)
+            return true;
+        STAT(reallocBytes, toItemSize(v->len));
+        memcpy(items, v->items, toItemSize(v->len));
+    } else {
+        if (v->head) {
+            moveItems(base, v->items, v->len);
+            v->items = base;
+            v->cap = total;
+            v->head = 0;
+        }
+        items = allocator->realloc(base, toItemSize(total), toItemSize(size), allocator->ctx);
+        if (!items)
+            return true;
+        STAT(reallocBytes, toItemSize(MIN(total, size)));
+    }
+    STAT(resizes, 1);
+    statCapacity(size);
+    v->inlined = !v->embedded && items == inlineItems(v);
+    v->overlay = false;
+    v->items = items;
+    v->cap = size;
+    v->head = 0;
+    return false;
+}
+
+
+bool axv_shrinkToFit(axvector *v) {
+    if (v->overlay)
+        return false;
+    return axv_resize(v, v->len);
 }
 
 
-axvector *axv_rslice(axvector *v, int64_t index1, int64_t index2) {
-    int64_t i1 = index1 + (index1 < 0) * axv_len(v);
-    int64_t i2 = index2 + (index2 < 0) * axv_len(v);
-    i1 = MAX(0, i1); i1 = MIN(i1, axv_len(v));
-    i2 = MAX(0, i2); i2 = MIN(i2, axv_len(v));
-
-    axvector *v2 = axv_newSized(v->len);
-    if (!v2)
-        return NULL;
-    void **save = v2->items;
-    for (int64_t i = i2 - 1; i >= i1; --i)
-        *save++ = v->items[i];
-    v2->len = i2 - i1;
-    v2->cmp = v->cmp;
-    v2->context = v->context;
-    v2->destroy = NULL;
-    return v2;
+bool axv_reserve(axvector *v, uint64_t n) {
+    if (n <= v->cap)
+        return false;
+    if (v->head + v->cap >= n && (v->head >= v->len || v->locked) && !v->shared) {
+        // reclaim the free slots in front instead of growing
+        moveItems(v->items - v->head, v->items, v->len);
+        v->items -= v->head;
+        v->cap += v->head;
+        v->head = 0;
+        return false;
+    }
+    return axv_resize(v, MAX(n, v->grow(v->cap, n, v->growParam)));
 }
 
 
-bool axv_resize(axvector *v, uint64_t size) {
-    if (v->locked)
+bool axv_reserveFront(axvector *v, uint64_t n) {
+    if (n <= v->head)
+        return false;
+    if (unshare(v))
         return true;
-    if (size < v->len && v->destroy) {
-        while (v->len > size)
-            v->destroy(v->items[--v->len]);
+    uint64_t spare = v->cap - v->len;
+    uint64_t move;
+    if (v->locked) {
+        if (v->head + spare < n)
+            return true;
+        // split the free capacity at the end between both ends
+        move = MIN(spare, MAX(n - v->head, (spare + 1) / 2));
+        moveItems(v->items + move, v->items, v->len);
+        v->items += move;
+        v->head += move;
+        v->cap -= move;
+        return false;
+    }
+    move = MAX(n - v->head, v->len);
+    const axv_allocator *allocator = v->allocator;
+    uint64_t total = v->head + v->cap;
+    void **base;
+    if (v->inlined || v->overlay) {
+        base = allocator->alloc(toItemSize(total + move), allocator->ctx);
+        if (!base)
+            return true;
+        STAT(reallocBytes, toItemSize(v->len));
+        memcpy(base + v->head + move, v->items, toItemSize(v->len));
     } else {
-        v->len = MIN(v->len, size);
+        base = allocator->realloc(v->items - v->head, toItemSize(total), toItemSize(total + move), allocator->ctx);
+        if (!base)
+            return true;
+        STAT(reallocBytes, toItemSize(total));
+        moveItems(base + v->head + move, base + v->head, v->len);
     }
-    size = MAX(1, size);
-    void **items = realloc_(v->items, toItemSize(size));
-    if (!items)
-        return true;
-    v->items = items;
-    v->cap = size;
+    STAT(resizes, 1);
+    statCapacity(total + move);
+    v->inlined = false;
+    v->overlay = false;
+    v->head += move;
+    v->items = base + v->head;
     return false;
 }
 
@@ -288,9 +1529,11 @@ bool axv_resize(axvector *v, uint64_t size) {
 void *axv_max(axvector *v) {
     if (v->len == 0)
         return NULL;
+    if (v->cmp == axv_compareAddress)
+        return (void *) maxAddress(v->items, v->len);
     void *max = *v->items;
     for (uint64_t i = 1; i < v->len; ++i) {
-        if (v->cmp(v->items + i, &max) > 0)
+        if (callComparator(v, v->items + i, &max) > 0)
             max = v->items[i];
     }
     return max;
@@ -300,9 +1543,11 @@ void *axv_max(axvector *v) {
 void *axv_min(axvector *v) {
     if (v->len == 0)
         return NULL;
+    if (v->cmp == axv_compareAddress)
+        return (void *) minAddress(v->items, v->len);
     void *min = *v->items;
     for (uint64_t i = 1; i < v->len; ++i) {
-        if (v->cmp(v->items + i, &min) < 0)
+        if (callComparator(v, v->items + i, &min) < 0)
             min = v->items[i];
     }
     return min;
@@ -332,11 +1577,16 @@ bool axv_all(axvector *v, bool (*f)(const void *, void *), void *arg) {
 
 
 uint64_t axv_count(axvector *v, void *val) {
+    struct axv_index *ix = validIndex(v);
+    if (ix)
+        return indexFind(v, ix, val, mixHash(v->hash(val)))->count;
+    if (v->cmp == axv_compareAddress)
+        return countAddress(v->items, v->len, val);
     uint64_t n = 0;
     void **curr = v->items;
     void **bound = v->items + v->len;
     while (curr < bound)
-        n += v->cmp(&val, curr++) == 0;
+        n += callComparator(v, &val, curr++) == 0;
     return n;
 }
 
@@ -344,8 +1594,10 @@ uint64_t axv_count(axvector *v, void *val) {
 bool axv_compare(axvector *v1, axvector *v2) {
     if (v1->len != v2->len)
         return false;
+    if (v1->cmp == axv_compareAddress)
+        return memcmp(v1->items, v2->items, toItemSize(v1->len)) == 0;
     for (uint64_t i = 0; i < v1->len; ++i) {
-        if (v1->cmp(v1->items + i, v2->items + i) != 0)
+        if (callComparator(v1, v1->items + i, v2->items + i) != 0)
             return false;
     }
     return true;
@@ -353,6 +1605,9 @@ bool axv_compare(axvector *v1, axvector *v2) {
 
 
 axvector *axv_map(axvector *v, void *(*f)(void *, void *), void *arg) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
     void **val = v->items;
     void **bound = v->items + v->len;
     while (val < bound) {
@@ -364,23 +1619,36 @@ axvector *axv_map(axvector *v, void *(*f)(void *, void *), void *arg) {
 
 
 axvector *axv_filter(axvector *v, bool (*f)(const void *, void *), void *arg) {
-    uint64_t len = 0;
-    const bool shouldFree = v->destroy;
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    void *dead[DESTROY_BATCH];
+    uint64_t len = 0, ndead = 0;
+    const bool shouldFree = v->destroy || v->destroyBatch;
     for (uint64_t i = 0; i < v->len; ++i) {
         if (f(v->items[i], arg)) {
             v->items[len++] = v->items[i];
         } else if (shouldFree) {
-            v->destroy(v->items[i]);
+            dead[ndead++] = v->items[i];
+            if (ndead == DESTROY_BATCH) {
+                destroyItems(v, dead, ndead);
+                ndead = 0;
+            }
         }
     }
+    destroyItems(v, dead, ndead);
     v->len = len;
+    shrink(v);
     return v;
 }
 
 
 axvector *axv_partition(axvector *v, bool (*f)(const void *, void *), void *arg) {
-    axvector *v2 = axv_newSized(v->len);
+    if (unshare(v))
+        return NULL;
+    axvector *v2 = axv_newWithAllocator(v->len, v->allocator);
     if (!v2) return NULL;
+    invalidateIndex(v);
 
     uint64_t len1 = 0, len2 = 0;
     for (uint64_t i = 0; i < v->len; ++i) {
@@ -394,12 +1662,128 @@ axvector *axv_partition(axvector *v, bool (*f)(const void *, void *), void *arg)
     v->len = len1;
     v2->len = len2;
     v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
+    v2->context = v->context;
+    v2->destroy = v->destroy;
+    v2->destroyBatch = v->destroyBatch;
+    return v2;
+}
+
+
+axvector *axv_mapBatch(axvector *v, void (*f)(void **, uint64_t, void *), void *arg) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    if (v->len)
+        f(v->items, v->len, arg);
+    return v;
+}
+
+
+axvector *axv_filterBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    bool keep[AXV_BATCH];
+    void *dead[AXV_BATCH];
+    uint64_t len = 0;
+    for (uint64_t i = 0; i < v->len; i += AXV_BATCH) {
+        const uint64_t n = MIN(AXV_BATCH, v->len - i);
+        uint64_t ndead = 0;
+        f(v->items + i, n, keep, arg);
+        for (uint64_t k = 0; k < n; ++k) {
+            void *item = v->items[i + k];
+            if (keep[k])
+                v->items[len++] = item;
+            else
+                dead[ndead++] = item;
+        }
+        destroyItems(v, dead, ndead);
+    }
+    v->len = len;
+    shrink(v);
+    return v;
+}
+
+
+axvector *axv_partitionBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg) {
+    if (unshare(v))
+        return NULL;
+    axvector *v2 = axv_newWithAllocator(v->len, v->allocator);
+    if (!v2) return NULL;
+    invalidateIndex(v);
+
+    bool keep[AXV_BATCH];
+    uint64_t len1 = 0, len2 = 0;
+    for (uint64_t i = 0; i < v->len; i += AXV_BATCH) {
+        const uint64_t n = MIN(AXV_BATCH, v->len - i);
+        f(v->items + i, n, keep, arg);
+        for (uint64_t k = 0; k < n; ++k) {
+            void *item = v->items[i + k];
+            if (keep[k])
+                v->items[len1++] = item;
+            else
+                v2->items[len2++] = item;
+        }
+    }
+
+    v->len = len1;
+    v2->len = len2;
+    v2->cmp = v->cmp;
+    v2->hash = v->hash;
+    v2->grow = v->grow;
+    v2->growParam = v->growParam;
+    v2->autoShrink = v->autoShrink;
     v2->context = v->context;
     v2->destroy = v->destroy;
+    v2->destroyBatch = v->destroyBatch;
     return v2;
 }
 
 
+static bool anyBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg, bool expected) {
+    bool result[AXV_BATCH];
+    for (uint64_t i = 0; i < v->len; i += AXV_BATCH) {
+        const uint64_t n = MIN(AXV_BATCH, v->len - i);
+        f(v->items + i, n, result, arg);
+        for (uint64_t k = 0; k < n; ++k) {
+            if (result[k] == expected)
+                return true;
+        }
+    }
+    return false;
+}
+
+
+bool axv_anyBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg) {
+    return anyBatch(v, f, arg, true);
+}
+
+
+bool axv_allBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg) {
+    return !anyBatch(v, f, arg, false);
+}
+
+
+axvector *axv_foreachBatch(axvector *v, bool (*f)(void **, uint64_t, void *), void *arg) {
+    for (uint64_t i = 0; i < v->len; i += AXV_BATCH) {
+        if (!f(v->items + i, MIN(AXV_BATCH, v->len - i), arg))
+            return v;
+    }
+    return v;
+}
+
+
+axv_cursor axv_cursorAt(axvector *v, int64_t index, uint64_t distance) {
+    const uint64_t i = normaliseIndex(v->len, index);
+    axv_cursor c = {v, i > v->len ? v->len : i, distance};
+    return c;
+}
+
+
 axvector *axv_foreach(axvector *v, bool (*f)(void *, void *), void *arg) {
     const int64_t length = axv_len(v);
     for (int64_t i = 0; i < length; ++i) {
@@ -423,25 +1807,352 @@ axvector *axv_rforeach(axvector *v, bool (*f)(void *, void *), void *arg) {
 
 bool axv_isSorted(axvector *v) {
     for (uint64_t i = 1; i < v->len; ++i) {
-        if (v->cmp(v->items + i - 1, v->items + i) != 0)
+        if (callComparator(v, v->items + i - 1, v->items + i) != 0)
             return false;
     }
     return true;
 }
 
 
+axvector *axv_sort(axvector *v) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    sortItems(v, v->items, v->len);
+    return v;
+}
+
+
 axvector *axv_sortSection(axvector *v, int64_t index1, int64_t index2) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
     uint64_t i1 = normaliseIndex(v->len, index1);
     uint64_t i2 = normaliseIndex(v->len, index2);
-    qsort(v->items + i1, i2 - i1, sizeof *v->items, v->cmp);
+    if (i1 < i2 && i2 <= v->len)
+        sortItems(v, v->items + i1, i2 - i1);
+    return v;
+}
+
+
+bool axv_stableSort(axvector *v) {
+    if (v->len < 2)
+        return false;
+    if (unshare(v))
+        return true;
+    const uint64_t size = toItemSize(v->len / 2);
+    void **scratch = v->allocator->alloc(size, v->allocator->ctx);
+    if (!scratch)
+        return true;
+    invalidateIndex(v);
+    if (v->cmp == axv_compareAddress)
+        sortAddressesStable_(v->items, v->len, scratch, NULL);
+    else
+        sortComparatorStable_(v->items, v->len, scratch, v);
+    v->allocator->free(scratch, size, v->allocator->ctx);
+    return false;
+}
+
+
+axvector *axv_partialSort(axvector *v, uint64_t k) {
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    if (v->cmp == axv_compareAddress)
+        sortAddressesPartial_(v->items, v->len, k, NULL);
+    else
+        sortComparatorPartial_(v->items, v->len, k, v);
+    return v;
+}
+
+
+bool axv_nthElement(axvector *v, int64_t index) {
+    uint64_t i = normaliseIndex(v->len, index);
+    if (i >= v->len || unshare(v))
+        return true;
+    invalidateIndex(v);
+    if (v->cmp == axv_compareAddress)
+        sortAddressesSelect_(v->items, v->len, i, NULL);
+    else
+        sortComparatorSelect_(v->items, v->len, i, v);
+    return false;
+}
+
+
+typedef struct keyedItem {
+    uint64_t key;
+    void *item;
+} keyedItem;
+
+
+static uint64_t floatToKey(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof bits);
+    return bits >> 63 ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+
+static void radixSort(axvector *v, keyedItem *src, keyedItem *dst) {
+    static const unsigned digits = sizeof(uint64_t);
+    uint64_t counts[sizeof(uint64_t)][256] = {{0}};
+    for (uint64_t i = 0; i < v->len; ++i) {
+        for (unsigned d = 0; d < digits; ++d)
+            ++counts[d][(src[i].key >> (d * 8)) & 0xFF];
+    }
+
+    for (unsigned d = 0; d < digits; ++d) {
+        uint64_t *count = counts[d];
+        if (count[(src[0].key >> (d * 8)) & 0xFF] == v->len)
+            continue;
+        uint64_t offset = 0;
+        for (unsigned b = 0; b < 256; ++b) {
+            uint64_t n = count[b];
+            count[b] = offset;
+            offset += n;
+        }
+        for (uint64_t i = 0; i < v->len; ++i)
+            dst[count[(src[i].key >> (d * 8)) & 0xFF]++] = src[i];
+        keyedItem *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    for (uint64_t i = 0; i < v->len; ++i)
+        v->items[i] = src[i].item;
+}
+
+
+bool axv_sortByKey(axvector *v, uint64_t (*key)(const void *)) {
+    if (v->len < 2)
+        return false;
+    if (unshare(v))
+        return true;
+    keyedItem *buf = v->allocator->alloc(2 * v->len * sizeof *buf, v->allocator->ctx);
+    if (!buf)
+        return true;
+    for (uint64_t i = 0; i < v->len; ++i) {
+        buf[i].key = key(v->items[i]);
+        buf[i].item = v->items[i];
+    }
+    invalidateIndex(v);
+    radixSort(v, buf, buf + v->len);
+    v->allocator->free(buf, 2 * v->len * sizeof *buf, v->allocator->ctx);
+    return false;
+}
+
+
+bool axv_sortByFloatKey(axvector *v, double (*key)(const void *)) {
+    if (v->len < 2)
+        return false;
+    if (unshare(v))
+        return true;
+    keyedItem *buf = v->allocator->alloc(2 * v->len * sizeof *buf, v->allocator->ctx);
+    if (!buf)
+        return true;
+    for (uint64_t i = 0; i < v->len; ++i) {
+        buf[i].key = floatToKey(key(v->items[i]));
+        buf[i].item = v->items[i];
+    }
+    invalidateIndex(v);
+    radixSort(v, buf, buf + v->len);
+    v->allocator->free(buf, 2 * v->len * sizeof *buf, v->allocator->ctx);
+    return false;
+}
+
+
+static uint64_t bound(axvector *v, void *val, bool upper) {
+    uint64_t lo = 0, hi = v->len;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int c = compareItems(v, v->items[mid], val);
+        if (c < 0 || (upper && c == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+int64_t axv_lowerBound(axvector *v, void *val) {
+    return (int64_t) bound(v, val, false);
+}
+
+
+int64_t axv_upperBound(axvector *v, void *val) {
+    return (int64_t) bound(v, val, true);
+}
+
+
+bool axv_insertSorted(axvector *v, void *val) {
+    return axv_insertN(v, (int64_t) bound(v, val, true), &val, 1);
+}
+
+
+bool axv_removeSorted(axvector *v, void *val) {
+    uint64_t i = bound(v, val, false);
+    if (i == v->len || compareItems(v, v->items[i], val) != 0)
+        return true;
+    return axv_eraseRange(v, (int64_t) i, (int64_t) i + 1);
+}
+
+
+bool axv_mergeSorted(axvector *v1, axvector *v2) {
+    invalidateIndex(v1);
+    const uint64_t n1 = v1->len, n2 = v2->len;
+    if (axv_reserve(v1, n1 + n2) || unshare(v1))
+        return true;
+    void **items = v1->items;
+    if (v1 == v2) {
+        for (uint64_t i = n1; i-- > 0;)
+            items[2 * i] = items[2 * i + 1] = items[i];
+    } else {
+        void **src = v2->items;
+        uint64_t i = n1, j = n2, k = n1 + n2;
+        while (j > 0) {
+            if (i > 0 && compareItems(v1, items[i - 1], src[j - 1]) > 0)
+                items[--k] = items[--i];
+            else
+                items[--k] = src[--j];
+        }
+    }
+    v1->len = n1 + n2;
+    return false;
+}
+
+
+axvector *axv_unique(axvector *v) {
+    if (v->len < 2)
+        return v;
+    if (unshare(v))
+        return NULL;
+    invalidateIndex(v);
+    void *dead[DESTROY_BATCH];
+    uint64_t len = 1, ndead = 0;
+    const bool shouldFree = v->destroy || v->destroyBatch;
+    for (uint64_t i = 1; i < v->len; ++i) {
+        if (compareItems(v, v->items[len - 1], v->items[i]) != 0) {
+            v->items[len++] = v->items[i];
+        } else if (shouldFree) {
+            dead[ndead++] = v->items[i];
+            if (ndead == DESTROY_BATCH) {
+                destroyItems(v, dead, ndead);
+                ndead = 0;
+            }
+        }
+    }
+    destroyItems(v, dead, ndead);
+    v->len = len;
+    return v;
+}
+
+
+/*
+    Find the first index in [lo, n) whose item does not compare less than val, given that the item at lo does. The
+    distance to it is found by exponential search, then binary search, so skipping a run of k items takes O(log k).
+*/
+static uint64_t gallop(axvector *v, void **items, uint64_t lo, uint64_t n, void *val) {
+    uint64_t hi = lo + 1, step = 1;
+    while (hi < n && compareItems(v, items[hi], val) < 0) {
+        lo = hi;
+        hi += step;
+        step <<= 1;
+    }
+    hi = MIN(hi, n);
+    while (lo + 1 < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (compareItems(v, items[mid], val) < 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return hi;
+}
+
+
+enum setOperation {
+    INTERSECT,
+    UNION,
+    DIFFERENCE
+};
+
+
+static axvector *combineSorted(axvector *v1, axvector *v2, enum setOperation op) {
+    const uint64_t n1 = v1->len, n2 = v2->len;
+    axvector *v = axv_newWithAllocator(op == INTERSECT ? MIN(n1, n2) : op == UNION ? n1 + n2 : n1, v1->allocator);
+    if (!v)
+        return NULL;
+    v->cmp = v1->cmp;
+    v->hash = v1->hash;
+    v->grow = v1->grow;
+    v->growParam = v1->growParam;
+    v->autoShrink = v1->autoShrink;
+    v->context = v1->context;
+
+    void **a = v1->items, **b = v2->items, **out = v->items;
+    uint64_t i = 0, j = 0;
+    while (i < n1 && j < n2) {
+        int c = compareItems(v1, a[i], b[j]);
+        if (c < 0) {
+            uint64_t k = gallop(v1, a, i, n1, b[j]);
+            if (op != INTERSECT) {
+                copyItems(out, a + i, k - i);
+                out += k - i;
+            }
+            i = k;
+        } else if (c > 0) {
+            uint64_t k = gallop(v1, b, j, n2, a[i]);
+            if (op == UNION) {
+                copyItems(out, b + j, k - j);
+                out += k - j;
+            }
+            j = k;
+        } else {
+            if (op != DIFFERENCE)
+                *out++ = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    if (op != INTERSECT) {
+        copyItems(out, a + i, n1 - i);
+        out += n1 - i;
+    }
+    if (op == UNION) {
+        copyItems(out, b + j, n2 - j);
+        out += n2 - j;
+    }
+    v->len = out - v->items;
     return v;
 }
 
 
+axvector *axv_intersect(axvector *v1, axvector *v2) {
+    return combineSorted(v1, v2, INTERSECT);
+}
+
+
+axvector *axv_union(axvector *v1, axvector *v2) {
+    return combineSorted(v1, v2, UNION);
+}
+
+
+axvector *axv_difference(axvector *v1, axvector *v2) {
+    return combineSorted(v1, v2, DIFFERENCE);
+}
+
+
 int64_t axv_linearSearch(axvector *v, void *val) {
+    struct axv_index *ix = validIndex(v);
+    if (ix) {
+        indexEntry *e = indexFind(v, ix, val, mixHash(v->hash(val)));
+        return e->count ? (int64_t) (e->first - ix->base) : -1;
+    }
+    if (v->cmp == axv_compareAddress)
+        return searchAddress(v->items, v->len, val);
     const int64_t length = axv_len(v);
     for (int64_t i = 0; i < length; ++i) {
-        if (v->cmp(&val, v->items + i) == 0)
+        if (callComparator(v, &val, v->items + i) == 0)
             return i;
     }
     return -1;
@@ -449,13 +2160,116 @@ int64_t axv_linearSearch(axvector *v, void *val) {
 
 
 axvector *axv_setComparator(axvector *v, int (*cmp)(const void *, const void *)) {
-    v->cmp = cmp ? cmp : defaultComparator;
+    v->cmp = cmp ? cmp : axv_compareAddress;
+    invalidateIndex(v);
+    return v;
+}
+
+
+axvector *axv_setHash(axvector *v, uint64_t (*hash)(const void *)) {
+    if (hash != v->hash)
+        freeIndex(v);
+    v->hash = hash;
+    return v;
+}
+
+
+int axv_compareAddress(const void *a, const void *b) {
+    return AXV_COMPARE_ADDRESSES(*(void *const *) a, *(void *const *) b);
+}
+
+
+uint64_t axv_hashAddress(const void *item) {
+    return mixHash((uintptr_t) item);
+}
+
+
+axvector *axv_touch(axvector *v) {
+    invalidateIndex(v);
+    return v;
+}
+
+
+bool axv_dedupe(axvector *v) {
+    uint64_t (*hash)(const void *) = v->hash;
+    if (!hash && v->cmp == axv_compareAddress)
+        hash = axv_hashAddress;
+    struct axv_index set = {NULL, 0, 0, 0, false};
+    if (!hash || unshare(v) || indexAlloc(v, &set, v->len))
+        return true;
+    invalidateIndex(v);
+    void *dead[DESTROY_BATCH];
+    uint64_t len = 0, ndead = 0;
+    for (uint64_t i = 0; i < v->len; ++i) {
+        indexEntry *e = indexAdd(v, &set, v->items[i], mixHash(hash(v->items[i])), len);
+        if (e->count == 1) {
+            v->items[len++] = v->items[i];
+        } else {
+            dead[ndead++] = v->items[i];
+            if (ndead == DESTROY_BATCH) {
+                destroyItems(v, dead, ndead);
+                ndead = 0;
+            }
+        }
+    }
+    destroyItems(v, dead, ndead);
+    v->len = len;
+    v->allocator->free(set.entries, indexBytes(&set), v->allocator->ctx);
+    return false;
+}
+
+
+axvector *axv_setGrowth(axvector *v, uint64_t (*grow)(uint64_t, uint64_t, uint64_t), uint64_t param) {
+    v->grow = grow ? grow : axv_growGeometric;
+    v->growParam = grow ? param : 200;
     return v;
 }
 
 
+uint64_t axv_growGeometric(uint64_t cap, uint64_t required, uint64_t percent) {
+    (void) required;
+    return cap / 100 * percent + cap % 100 * percent / 100 + 1;
+}
+
+
+uint64_t axv_growLinear(uint64_t cap, uint64_t required, uint64_t step) {
+    (void) required;
+    return cap + step;
+}
+
+
+const axv_allocator *axv_defaultAllocator(void) {
+    return &defaultAllocator;
+}
+
+
 void axv_memoryfn(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *)) {
     malloc_ = malloc_fn ? malloc_fn : malloc;
     realloc_ = realloc_fn ? realloc_fn : realloc;
     free_ = free_fn ? free_fn : free;
 }
+
+
+axv_statistics axv_stats(bool reset) {
+    axv_statistics snapshot = {0};
+#ifdef AXV_STATS
+    if (reset) {
+        snapshot.resizes = atomic_exchange_explicit(&stats.resizes, 0, memory_order_relaxed);
+        snapshot.reallocBytes = atomic_exchange_explicit(&stats.reallocBytes, 0, memory_order_relaxed);
+        snapshot.movedBytes = atomic_exchange_explicit(&stats.movedBytes, 0, memory_order_relaxed);
+        snapshot.comparisons = atomic_exchange_explicit(&stats.comparisons, 0, memory_order_relaxed);
+        snapshot.destructions = atomic_exchange_explicit(&stats.destructions, 0, memory_order_relaxed);
+        snapshot.maxCapacity = atomic_exchange_explicit(&stats.maxCapacity, 0, memory_order_relaxed);
+    } else {
+        snapshot.resizes = atomic_load_explicit(&stats.resizes, memory_order_relaxed);
+        snapshot.reallocBytes = atomic_load_explicit(&stats.reallocBytes, memory_order_relaxed);
+        snapshot.movedBytes = atomic_load_explicit(&stats.movedBytes, memory_order_relaxed);
+        snapshot.comparisons = atomic_load_explicit(&stats.comparisons, memory_order_relaxed);
+        snapshot.destructions = atomic_load_explicit(&stats.destructions, memory_order_relaxed);
+        snapshot.maxCapacity = atomic_load_explicit(&stats.maxCapacity, memory_order_relaxed);
+    }
+#else
+    (void) reset;
+#endif
+    return snapshot;
+}
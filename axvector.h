@@ -25,9 +25,25 @@ extern "C" {
 
     Some functions use a comparator. The default comparator compares the addresses of items, but a custom
     comparator can be given and shall conform to the C standard library's comparison function specifications.
+    With the default comparator, searching, counting, comparing and finding the least or greatest item is done without
+    calling the comparator, using SIMD instructions where available (unless the library is compiled with AXV_NO_SIMD
+    defined). On aarch64, the NEON instructions are only used if the library is compiled with AXV_NEON defined.
+
+    When a vector has to grow, its new capacity is determined by its growth policy. The default policy doubles the
+    capacity. A custom policy can be given as a function taking (current capacity, required capacity, parameter) and
+    returning the new capacity. The parameter is stored alongside the policy in the vector. axv_growGeometric() and
+    axv_growLinear() are built-in policies.
+
+    Capacity is only given back on request, e.g. by axv_shrinkToFit(). Optionally, a vector shrinks automatically:
+    once axv_pop(), axv_discard(), axv_filter(), axv_filterBatch() or axv_clear() leave it less than a quarter full,
+    its capacity is reduced to twice its length. The gap between both thresholds keeps a vector whose length
+    oscillates from being resized over and over.
 
     A destructor function may also be supplied. There is no default destructor. The destructor will be called on items
     that are irrevocably removed from the vector. Its prototype is void (*)(void *), like the free() function.
+    Alternatively, a batch destructor of prototype void (*)(void **items, uint64_t n, void *context) may be supplied.
+    It is handed whole runs of removed items at once together with the vector's context, which allows e.g. a pool
+    allocator to release them in one go. If a batch destructor is set, it is used instead of the destructor.
 
     To provide built-in bookkeeping, the vector also has storage for a context. This is simply a void *. The context is
     not used by the vector itself and is exclusively controlled by the user.
@@ -35,20 +51,134 @@ extern "C" {
     axvector supports negative indexing: -1 is the last item, -2 the penultimate one etc. All functions that take
     two indices to signify a section treat the first index inclusively and the second index exclusively.
 
+    Memory is obtained from an allocator. By default, vectors use the memory functions set by axv_memoryfn(), but a
+    vector can be given its own allocator upon creation, e.g. an arena. All memory the vector itself and the functions
+    called on it need is then taken from that allocator, and vectors derived from it (copies, slices, partitions)
+    use it as well.
+
+    On unix systems, the default allocator maps blocks of AXV_MMAP_THRESHOLD bytes or more (a compile-time option of
+    the library, 64 MiB by default, 0 to disable) directly from the operating system instead of using the memory
+    functions. Address space for several times the block size is reserved up front and memory is only committed as
+    the vector grows, so large vectors grow without copying their items. Where supported, transparent huge pages are
+    requested for these blocks to reduce TLB misses while sorting and scanning.
+
+    Short vectors keep their items inline: every vector created by the library is allocated together with room for
+    AXV_INLINE_CAP items (a compile-time option of the library, 8 by default). As long as the capacity does not exceed
+    that, no separate allocation is made for the items. Growing past it moves the items to the heap, shrinking back
+    below it moves them inline again.
+
+    A vector can also be used as a deque. Items popped off the front with axv_popFront() leave free slots in front of
+    the first item, which axv_pushFront() fills again before it has to make room. Making room moves the items back by
+    as many slots as there are items, so pushing and popping at either end takes amortised constant time. The items
+    always stay contiguous, hence indexing and raw access through axv_data() are unaffected. Free slots in front
+    of the first item do not count towards the capacity and are reclaimed when the vector has to grow.
+
+    Searching and counting can be sped up by a hash index. Once a hash function consistent with the comparator is
+    set, axv_linearSearch() and axv_count() build an index of all items on first use and answer from it in expected
+    constant time. The index is kept up to date by axv_push(), axv_pop(), axv_pushFront(), axv_popFront() and
+    axv_set(). All other functions changing the items mark it stale, and it is rebuilt by the next search. The index
+    does not notice items changed through axv_data() or views, call axv_touch() afterwards.
+
+    axv_snapshot() creates a vector sharing the internal array of another one in constant time. The array is
+    reference-counted and copied only once either vector is about to change its items or capacity, so snapshots that
+    are only read never copy anything. Removing items from the end or the front does not copy either. As copying may
+    run out of memory, on a shared vector functions changing the items can fail: functions returning Self return NULL
+    then, and functions returning true iff an error occurred return true. The vector is unmodified in this case.
+    Vectors sharing an array may be used by different threads. Before writing to the items through axv_data(), call
+    axv_unshare().
+
     The struct definition of axvector is given in its header for optimisation purposes only. To use axvector, you must
     rely solely on the functions of the library.
 */
+typedef struct axv_allocator {
+    void *(*alloc)(size_t size, void *ctx);
+    void *(*realloc)(void *ptr, size_t oldSize, size_t size, void *ctx);
+    void (*free)(void *ptr, size_t size, void *ctx);
+    void *ctx;
+} axv_allocator;
+
 typedef struct axvector {
     void **items;
+    const axv_allocator *allocator;
     uint64_t len;
     uint64_t cap;
+    uint64_t head;
     int (*cmp)(const void *, const void *);
     void (*destroy)(void *);
+    void (*destroyBatch)(void **, uint64_t, void *);
+    uint64_t (*hash)(const void *);
+    struct axv_index *index;
+    struct axv_share *shared;
     void *context;
+    uint64_t (*grow)(uint64_t, uint64_t, uint64_t);
+    uint64_t growParam;
     bool locked;
     bool overlay;
+    bool inlined;
+    bool embedded;
+    bool autoShrink;
 } axvector;
 
+typedef struct axv_cursor {
+    axvector *v;
+    uint64_t pos;
+    uint64_t distance;
+} axv_cursor;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AXV_PREFETCH_(p) __builtin_prefetch(p)
+#else
+#define AXV_PREFETCH_(p) ((void) (p))
+#endif
+
+typedef struct axv_statistics {
+    uint64_t resizes;
+    uint64_t reallocBytes;
+    uint64_t movedBytes;
+    uint64_t comparisons;
+    uint64_t destructions;
+    uint64_t maxCapacity;
+} axv_statistics;
+
+typedef struct axview {
+    void **base;
+    int64_t stride;
+    uint64_t len;
+    int (*cmp)(const void *, const void *);
+} axview;
+
+
+/*
+    Hooks keeping the hash index up to date, called by the inline functions below. Not to be called directly.
+*/
+void axv_indexPushed_(axvector *v);
+void axv_indexPopped_(axvector *v, void *val);
+void axv_indexPushedFront_(axvector *v);
+void axv_indexPoppedFront_(axvector *v, void *val);
+void axv_indexSet_(axvector *v, uint64_t index, void *old);
+/**
+ * Give a vector an internal array of its own if it shares its array with snapshots, by copying it. If all other
+ * vectors sharing the array have been destroyed, the array is taken over without copying. Capacity and free slots in
+ * front of the first item are preserved.
+ * @return True iff OOM. The array is still shared in this case.
+ */
+bool axv_unshare(axvector *v);
+/*
+    Hook applying the automatic shrink policy, called by the inline functions below and by axvparallel. Not to be
+    called directly.
+*/
+void axv_autoShrink_(axvector *v);
+/*
+    Hook handing n removed items to the batch destructor or the destructor, if set, used by axvparallel. Not to be
+    called directly.
+*/
+void axv_destroyItems_(axvector *v, void **items, uint64_t n);
+/*
+    Hook sorting a range of items with the sort engine matching the comparator, without unsharing or marking the
+    index stale, used by axvparallel to sort chunks concurrently. Not to be called directly.
+*/
+void axv_sortItems_(axvector *v, void **items, uint64_t len);
+
 
 /**
  * Create axvector with starting capacity.
@@ -56,6 +186,16 @@ typedef struct axvector {
  * @return New axvector or NULL if OOM.
  */
 axvector *axv_newSized(uint64_t size);
+/**
+ * Create axvector with starting capacity using some allocator. The vector struct itself and its internal array are
+ * allocated from it. The allocator is not copied, so it must outlive the vector and all vectors derived from it.
+ * All of its functions are passed its ctx member. The realloc and free functions are also passed the size of the
+ * memory block as requested when it was allocated.
+ * @param size Capacity.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn().
+ * @return New axvector or NULL if OOM.
+ */
+axvector *axv_newWithAllocator(uint64_t size, const axv_allocator *allocator);
 /**
  * Create axvector with default capacity.
  * @return New axvector or NULL if OOM.
@@ -66,7 +206,9 @@ axvector *axv_new(void);
  * that array and how many could potentially be stored there. A new axvector is created using that item array as
  * its internal array. No heap allocations are made. Overlays are locked by default and do not free their internal
  * array upon destruction. Thus, it is not strictly necessary to call axv_destroy() on an overlay, as this will
- * only call the destructor on all items, if there is one.
+ * only call the destructor on all items, if there is one. If an overlay is unlocked and then resized, its items are
+ * moved to a heap array and it ceases to be an overlay. It must then be destroyed using axv_destroy() or
+ * axv_deinit().
  * @param items An array of items of type void *.
  * @param length Number of items currently stored in the items array. This must not exceed the capacity.
  * @param capacity Number of items that could potentially be stored in the items array. Upper limit of length.
@@ -75,7 +217,38 @@ axvector *axv_new(void);
  */
 axvector axv_newOverlay(void **items, uint64_t length, uint64_t capacity);
 /**
- * If destructor is set, call destructor on all items. Destroy axvector and free memory.
+ * Initialise an axvector in caller-owned memory, e.g. on the stack or embedded in another struct. Starting capacity
+ * is heap-allocated. Such a vector works like any other, but must be released with axv_deinit() (axv_destroy() does
+ * the same for it) and is never freed itself.
+ * @param size Capacity.
+ * @return True iff OOM, in which case the vector is left uninitialised.
+ */
+bool axv_init(axvector *v, uint64_t size);
+/**
+ * Initialise an axvector in caller-owned memory like axv_init(), allocating from some allocator.
+ * @param size Capacity.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn().
+ * @return True iff OOM, in which case the vector is left uninitialised.
+ */
+bool axv_initWithAllocator(axvector *v, uint64_t size, const axv_allocator *allocator);
+/**
+ * Initialise an empty axvector in caller-owned memory using a caller-owned buffer as its internal array, e.g. an
+ * array on the stack. No heap allocations are made. The vector starts out as an unlocked overlay of the buffer.
+ * Once it has to be resized, its items are moved to the heap and the buffer is not used anymore. Release it with
+ * axv_deinit().
+ * @param buffer An array of capacity items of type void *.
+ * @param capacity Number of items that fit into the buffer.
+ */
+void axv_initBuffer(axvector *v, void **buffer, uint64_t capacity);
+/**
+ * If destructor is set, call destructor on all items. Free the internal array of a vector initialised in
+ * caller-owned memory, unless it is still an overlay. The vector itself is not freed.
+ * @return Context.
+ */
+void *axv_deinit(axvector *v);
+/**
+ * If destructor is set, call destructor on all items. Destroy axvector and free memory. Vectors in caller-owned
+ * memory are only deinitialised, see axv_deinit().
  * @return Context.
  */
 void *axv_destroy(axvector *v);
@@ -86,15 +259,41 @@ void *axv_destroy(axvector *v);
  * @return True iff OOM.
  */
 bool axv_resize(axvector *v, uint64_t size);
+/**
+ * Make sure the vector can hold at least n items. If the capacity is less than n, the vector is resized according
+ * to its growth policy, giving amortised constant time when called repeatedly with growing n. Unlike axv_resize(),
+ * this never shrinks the vector.
+ * @param n Minimum capacity.
+ * @return True iff OOM during resize operation. Vector is unmodified in this case.
+ */
+bool axv_reserve(axvector *v, uint64_t n);
+/**
+ * Make sure at least n items can be pushed to the front of the vector without moving the others. If there are fewer
+ * free slots in front of the first item, the items are moved back, giving amortised constant time per item when
+ * called by axv_pushFront(). A locked vector can only use the free capacity at its end for this.
+ * @param n Minimum number of free slots in front of the first item.
+ * @return True iff OOM during resize operation. Vector is unmodified in this case.
+ */
+bool axv_reserveFront(axvector *v, uint64_t n);
+/**
+ * Reduce the capacity to the length of the vector, releasing all spare memory including free slots in front of the
+ * first item. Overlays are left as they are, as their memory is caller-owned.
+ * @return True iff OOM or the vector is locked. Vector is unmodified in this case.
+ */
+bool axv_shrinkToFit(axvector *v);
 /**
  * Push an item at the end of the vector. Vector is automatically resized if need be.
  * @param val Item.
  * @return True iff OOM during resize operation. Item is not pushed in this case.
  */
 static inline bool axv_push(axvector *v, void *val) {
-    if (v->len >= v->cap && axv_resize(v, (v->cap << 1) | 1))
+    if (v->len >= v->cap && axv_reserve(v, v->len + 1))
+        return true;
+    if (v->shared && axv_unshare(v))
         return true;
     v->items[v->len++] = val;
+    if (v->index)
+        axv_indexPushed_(v);
     return false;
 }
 /**
@@ -102,7 +301,14 @@ static inline bool axv_push(axvector *v, void *val) {
  * @return The last item.
  */
 static inline void *axv_pop(axvector *v) {
-    return v->len ? v->items[--v->len] : NULL;
+    if (v->len == 0)
+        return NULL;
+    void *val = v->items[--v->len];
+    if (v->index)
+        axv_indexPopped_(v, val);
+    if (v->autoShrink && v->len < (v->head + v->cap) / 4)
+        axv_autoShrink_(v);
+    return val;
 }
 /**
  * Get last item without removing it.
@@ -111,6 +317,47 @@ static inline void *axv_pop(axvector *v) {
 static inline void *axv_top(axvector *v) {
     return v->len ? v->items[v->len - 1] : NULL;
 }
+/**
+ * Push an item at the front of the vector. Amortised constant time.
+ * @param val Item.
+ * @return True iff OOM during resize operation. Item is not pushed in this case.
+ */
+static inline bool axv_pushFront(axvector *v, void *val) {
+    if (v->shared && axv_unshare(v))
+        return true;
+    if (v->head == 0 && axv_reserveFront(v, 1))
+        return true;
+    --v->items;
+    --v->head;
+    ++v->cap;
+    ++v->len;
+    v->items[0] = val;
+    if (v->index)
+        axv_indexPushedFront_(v);
+    return false;
+}
+/**
+ * Pop off (remove) the first item. Constant time.
+ * @return The first item.
+ */
+static inline void *axv_popFront(axvector *v) {
+    if (v->len == 0)
+        return NULL;
+    void *val = *v->items++;
+    --v->len;
+    --v->cap;
+    ++v->head;
+    if (v->index)
+        axv_indexPoppedFront_(v, val);
+    return val;
+}
+/**
+ * Get first item without removing it.
+ * @return The first item.
+ */
+static inline void *axv_peekFront(axvector *v) {
+    return v->len ? v->items[0] : NULL;
+}
 /**
  * Signed number of items in this vector.
  * @return Signed length of vector.
@@ -146,13 +393,16 @@ static inline void *axv_get(struct axvector *v, uint64_t index) {
  * Replace item at index with a new item.
  * @param index May be negative.
  * @param val The new item.
- * @return True iff index out of range.
+ * @return True iff index out of range or OOM while unsharing. Vector is unmodified in this case.
  */
 static inline bool axv_set(axvector *v, int64_t index, void *val) {
     uint64_t i = index + (index < 0) * v->len;
-    if (i >= v->len)
+    if (i >= v->len || (v->shared && axv_unshare(v)))
         return true;
+    void *old = v->items[i];
     v->items[i] = val;
+    if (v->index)
+        axv_indexSet_(v, i, old);
     return false;
 }
 /**
@@ -182,15 +432,40 @@ bool axv_reverseSection(axvector *v, int64_t index1, int64_t index2);
 axvector *axv_rotate(axvector *v, int64_t k);
 /**
  * Shift all items toward or away from some anchor point. If n is positive, all items starting at the anchor point
- * are shifted n places to the right and the vector is resized as needed. The resulting gap in the vector is
- * filled with zeroes. If n is negative, the first n items starting at the anchor point are removed from the vector.
- * Subsequent items are then shifted toward the anchor point. If a destructor is set, it is called upon all removed
- * items.
+ * are shifted n places to the right and the vector is resized as needed according to its growth policy. The
+ * resulting gap in the vector is filled with zeroes. If n is negative, the first n items starting at the anchor point
+ * are removed from the vector. Subsequent items are then shifted toward the anchor point, unless the anchor point is
+ * the first item, in which case removal takes constant time like axv_popFront(). If a destructor is set, it is called
+ * upon all removed items.
  * @param index The anchor point. May be negative. Inclusive.
  * @param n Positive to reserve space amidst the items. Negative to remove items and collapse the vector.
- * @return True iff OOM during resize operation. Vector is unmodified in this case.
+ * @return True iff index out of range or OOM during resize operation. Vector is unmodified in this case.
  */
 bool axv_shift(axvector *v, int64_t index, int64_t n);
+/**
+ * Push n items at the end of the vector. The vector is resized at most once, according to its growth policy.
+ * @param src Array of n items. Must not point into the vector itself.
+ * @param n Number of items to push.
+ * @return True iff OOM during resize operation. No item is pushed in this case.
+ */
+bool axv_pushN(axvector *v, void **src, uint64_t n);
+/**
+ * Insert n items before some index, shifting all items starting at that index n places to the right. The vector is
+ * resized at most once, according to its growth policy.
+ * @param index Position of the first inserted item. May be negative. Equal to the length to insert at the end.
+ * @param src Array of n items. Must not point into the vector itself.
+ * @param n Number of items to insert.
+ * @return True iff index out of range or OOM during resize operation. Vector is unmodified in this case.
+ */
+bool axv_insertN(axvector *v, int64_t index, void **src, uint64_t n);
+/**
+ * Remove all items in some section and close the resulting gap. If a destructor is set, it is called upon all
+ * removed items in a single pass before the remaining items are moved.
+ * @param index1 Beginning of section. May be negative. Inclusive.
+ * @param index2 End of section. May be negative. Exclusive.
+ * @return True iff index out of range. Vector is unmodified in this case.
+ */
+bool axv_eraseRange(axvector *v, int64_t index1, int64_t index2);
 /**
  * Remove the last n items. If a destructor is set, it is called upon all removed items.
  * @param n Number of items to remove.
@@ -204,13 +479,30 @@ axvector *axv_discard(axvector *v, uint64_t n);
 axvector *axv_clear(axvector *v);
 /**
  * Create a shallow copy of a vector. The copy contains all items of the original and is created with the same
- * capacity. The comparator and context are copied, the destructor is not.
+ * capacity and allocator. The comparator, growth policy and context are copied, the destructor is not.
  * @return New axvector or NULL if OOM.
  */
 axvector *axv_copy(axvector *v);
+/**
+ * Create a snapshot of a vector in constant time. The snapshot shares the internal array of the vector until either
+ * of them changes its items. Otherwise it is a shallow copy like one created by axv_copy(): the comparator, hash
+ * function, growth policy and context are copied, the destructor is not. Vectors whose items are inline or in
+ * caller-owned memory cannot share them and are copied. Writing to the items through axv_data() or a block of a
+ * cursor bypasses copy-on-write, call axv_unshare() first. axv_view() unshares the vector itself.
+ * @return New axvector or NULL if OOM.
+ */
+axvector *axv_snapshot(axvector *v);
+/**
+ * Check if a vector shares its internal array with others.
+ * @return True if shared, false if not.
+ */
+static inline bool axv_isShared(axvector *v) {
+    return v->shared != NULL;
+}
 /**
  * All items of the second vector are moved to the end of the first vector, thereby clearing the second vector.
- * If both vectors are the same, nothing is done. The first vector is resized as needed.
+ * If both vectors are the same, nothing is done. The first vector is resized as needed according to its growth
+ * policy.
  * @param v1 First vector.
  * @param v2 Second vector.
  * @return True iff OOM during resize operation.
@@ -218,7 +510,7 @@ axvector *axv_copy(axvector *v);
 bool axv_extend(axvector *v1, axvector *v2);
 /**
  * All items of the second vector are copied to the end of the first vector. No changes are done to the second
- * vector. The vectors may be the same. The first vector is resized as needed.
+ * vector. The vectors may be the same. The first vector is resized as needed according to its growth policy.
  * @param v1 First vector.
  * @param v2 Second vector.
  * @return True iff OOM during resize operation.
@@ -226,8 +518,8 @@ bool axv_extend(axvector *v1, axvector *v2);
 bool axv_concat(axvector *v1, axvector *v2);
 /**
  * Create a shallow copy of a vector. The copy contains all items of the original which are in the specified slice.
- * The copy is created with capacity equal to the number of items copied or 1 if the slice is empty. The comparator
- * and context are copied, the destructor is not.
+ * The copy is created with capacity equal to the number of items copied or 1 if the slice is empty. The comparator,
+ * growth policy and context are copied, the destructor is not.
  * @param index1 Beginning of slice. May be negative. Inclusive.
  * @param index2 End of slice. May be negative. Exclusive.
  * @return New axvector or NULL if OOM.
@@ -236,12 +528,86 @@ axvector *axv_slice(axvector *v, int64_t index1, int64_t index2);
 /**
  * Create a shallow copy of a vector. The copy contains all items of the original which are in the specified slice
  * in reverse order. The copy is created with capacity equal to the number of items copied or 1 if the slice is empty.
- * The comparator and context are copied, the destructor is not.
+ * The comparator, growth policy and context are copied, the destructor is not.
  * @param index1 Beginning of slice. May be negative. Inclusive.
  * @param index2 End of slice. May be negative. Exclusive.
  * @return New axvector or NULL if OOM.
  */
 axvector *axv_rslice(axvector *v, int64_t index1, int64_t index2);
+/**
+ * Create a view of some section of a vector. The view is an overlay of the original's internal array, so no memory
+ * is allocated and no items are copied. It can be passed to any function taking an axvector. Writing to the view
+ * writes to the original. The comparator and context are copied, the destructor is not. A view is locked and becomes
+ * invalid once the original is resized or destroyed. As writing to the view bypasses copy-on-write, an original
+ * sharing its array with snapshots is unshared first, and snapshots of the original taken while the view is in use
+ * see what is written to the view.
+ * @param index1 Beginning of section. May be negative. Inclusive.
+ * @param index2 End of section. May be negative. Exclusive.
+ * @return View in stack memory, hence no axv_destroy() necessary. Empty if OOM while unsharing.
+ */
+axvector axv_view(axvector *v, int64_t index1, int64_t index2);
+/**
+ * Create a strided view of some section of a vector. A positive stride k visits every k-th item of the section
+ * starting at its first item, a negative stride -k every k-th item starting at its last item, going backwards.
+ * No memory is allocated and no items are copied. A strided view is an axview and is used through the axv_view*
+ * functions. It becomes invalid once the original is resized or destroyed.
+ * @param index1 Beginning of section. May be negative. Inclusive.
+ * @param index2 End of section. May be negative. Exclusive.
+ * @param stride Distance between consecutive items of the view. If zero, the view is empty.
+ * @return Strided view.
+ */
+axview axv_stridedView(axvector *v, int64_t index1, int64_t index2, int64_t stride);
+/**
+ * Create a view of some section of a vector in reverse order, equivalent to axv_stridedView() with stride -1.
+ * This is the zero-copy counterpart of axv_rslice().
+ * @param index1 Beginning of section. May be negative. Inclusive.
+ * @param index2 End of section. May be negative. Exclusive.
+ * @return Strided view.
+ */
+axview axv_rview(axvector *v, int64_t index1, int64_t index2);
+/**
+ * Number of items in this strided view.
+ * @return Unsigned length of view.
+ */
+static inline uint64_t axv_viewLen(axview *w) {
+    return w->len;
+}
+/**
+ * Index strided view and return item.
+ * @param index May be negative.
+ * @return Item at index or NULL if index out of range.
+ */
+static inline void *axv_viewAt(axview *w, int64_t index) {
+    uint64_t uindex = index + (index < 0) * w->len;
+    return uindex < w->len ? w->base[(int64_t) uindex * w->stride] : NULL;
+}
+/**
+ * Strided view version of axv_any().
+ * @param f Some predicate to apply to the view.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff any item satisfies the predicate.
+ */
+bool axv_viewAny(axview *w, bool (*f)(const void *, void *), void *arg);
+/**
+ * Strided view version of axv_all().
+ * @param f Some predicate to apply to the view.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff all items satisfy the predicate.
+ */
+bool axv_viewAll(axview *w, bool (*f)(const void *, void *), void *arg);
+/**
+ * Strided view version of axv_count(), using the comparator of the original vector.
+ * @param val The value all items are to be compared against.
+ * @return The resulting count.
+ */
+uint64_t axv_viewCount(axview *w, void *val);
+/**
+ * Strided view version of axv_foreach(). Items are iterated in view order.
+ * @param f Function to call on items.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axview *axv_viewForeach(axview *w, bool (*f)(void *, void *), void *arg);
 /**
  * Search the greatest item according to the comparator using forward linear search.
  * @return The greatest item or NULL if the vector is empty.
@@ -271,7 +637,8 @@ bool axv_any(axvector *v, bool (*f)(const void *, void *), void *arg);
  */
 bool axv_all(axvector *v, bool (*f)(const void *, void *), void *arg);
 /**
- * Number of items in this vector comparing equal to the given argument according to the comparator.
+ * Number of items in this vector comparing equal to the given argument according to the comparator. Expected
+ * constant time if a hash function is set.
  * @param val The value all items are to be compared against.
  * @return The resulting count.
  */
@@ -332,19 +699,122 @@ axvector *axv_foreach(axvector *v, bool (*f)(void *, void *), void *arg);
  * @return Self.
  */
 axvector *axv_rforeach(axvector *v, bool (*f)(void *, void *), void *arg);
+/**
+ * Let f be a function taking (items, number of items, optional argument).
+ * Batch version of axv_map(): f is called once with all items of the vector, which it may overwrite in place. Does
+ * nothing if the vector is empty.
+ * @param f Function mapping an array of items in place.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axvector *axv_mapBatch(axvector *v, void (*f)(void **, uint64_t, void *), void *arg);
+/**
+ * Let f be a predicate taking (items, number of items n, array of n results, optional argument).
+ * Batch version of axv_filter(): f is called on consecutive blocks of at most AXV_BATCH items (a compile-time option
+ * of the library, 256 by default) and sets result i to whether item i is to be kept. Compaction and calling the
+ * destructor on removed items are done by the vector. f must not modify the items.
+ * @param f Some batch predicate to filter the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return Self.
+ */
+axvector *axv_filterBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg);
+/**
+ * Batch version of axv_partition(), with f like in axv_filterBatch().
+ * @param f Some batch predicate to partition the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return The new axvector containing all rejected items or NULL if OOM, in which case no filtering is done.
+ */
+axvector *axv_partitionBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg);
+/**
+ * Batch version of axv_any(), with f like in axv_filterBatch(). Stops after the first block with an item
+ * satisfying the predicate.
+ * @param f Some batch predicate to apply to the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff any item satisfies the predicate.
+ */
+bool axv_anyBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg);
+/**
+ * Batch version of axv_all(), with f like in axv_filterBatch(). Stops after the first block with an item not
+ * satisfying the predicate.
+ * @param f Some batch predicate to apply to the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff all items satisfy the predicate.
+ */
+bool axv_allBatch(axvector *v, void (*f)(void **, uint64_t, bool *, void *), void *arg);
+/**
+ * Let f be a function taking (items, number of items, optional argument).
+ * Batch version of axv_foreach(): f is called on consecutive blocks of at most AXV_BATCH items until it returns
+ * false or all items have been exhausted.
+ * @param f Function to call on blocks of items.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axvector *axv_foreachBatch(axvector *v, bool (*f)(void **, uint64_t, void *), void *arg);
+/**
+ * Create a cursor iterating over the items from some index to the last item. A cursor remembers its position as an
+ * index, so iteration can be paused and resumed at any time, and items pushed in between are visited as well. It
+ * can issue software prefetches for the objects the items point to, a given number of items ahead of the position,
+ * so that they are in cache by the time they are reached. Items need not be valid pointers, prefetching never faults.
+ * @param index Index of the first item to visit. May be negative. If out of range, the cursor is exhausted.
+ * @param distance Prefetch distance in items or 0 to not prefetch.
+ * @return Cursor in stack memory, hence no destruction necessary.
+ */
+axv_cursor axv_cursorAt(axvector *v, int64_t index, uint64_t distance);
+/**
+ * Advance a cursor by one item.
+ * @param val Where to store the item.
+ * @return True iff the cursor is exhausted. Nothing is stored in this case.
+ */
+static inline bool axv_next(axv_cursor *c, void **val) {
+    axvector *v = c->v;
+    if (c->pos >= v->len)
+        return true;
+    if (c->distance && c->pos + c->distance < v->len)
+        AXV_PREFETCH_(v->items[c->pos + c->distance]);
+    *val = v->items[c->pos++];
+    return false;
+}
+/**
+ * Advance a cursor by a block of up to n items. The objects of the items up to the prefetch distance past the block
+ * are prefetched.
+ * @param block Where to store a pointer to the first item of the block. It points into the internal array of the
+ * vector and is valid until the vector is resized. Like axv_data(), writing through it bypasses copy-on-write, so
+ * call axv_unshare() before creating the cursor if the vector may share its array with snapshots.
+ * @param n Maximum number of items in the block.
+ * @return Number of items in the block, 0 iff the cursor is exhausted or n is 0.
+ */
+static inline uint64_t axv_nextBlock(axv_cursor *c, void ***block, uint64_t n) {
+    axvector *v = c->v;
+    if (c->pos >= v->len)
+        return 0;
+    const uint64_t m = v->len - c->pos < n ? v->len - c->pos : n;
+    if (c->distance) {
+        const uint64_t end = c->pos + m + c->distance < v->len ? c->pos + m + c->distance : v->len;
+        for (uint64_t i = c->pos + c->distance; i < end; ++i)
+            AXV_PREFETCH_(v->items[i]);
+    }
+    *block = v->items + c->pos;
+    c->pos += m;
+    return m;
+}
+/**
+ * Get the position of a cursor.
+ * @return Index of the item visited next.
+ */
+static inline uint64_t axv_cursorPos(axv_cursor *c) {
+    return c->pos;
+}
 /**
  * Check if vector is sorted according to comparator. Items are checked linearly from first to last.
  * @return True if sorted, false if not.
  */
 bool axv_isSorted(axvector *v);
 /**
- * Sort vector using its comparator.
+ * Sort vector using its comparator. Introsort is used, so the sort is not stable. If the default comparator is
+ * set, items are compared inline without calling the comparator.
  * @return Self.
  */
-static inline axvector *axv_sort(axvector *v) {
-    qsort(v->items, v->len, sizeof *v->items, v->cmp);
-    return v;
-}
+axvector *axv_sort(axvector *v);
 /**
  * Sort section of vector using its comparator.
  * @param index1 Beginning of section. May be negative. Inclusive.
@@ -352,6 +822,45 @@ static inline axvector *axv_sort(axvector *v) {
  * @return Self.
  */
 axvector *axv_sortSection(axvector *v, int64_t index1, int64_t index2);
+/**
+ * Sort vector stably using its comparator, i.e. items comparing equal keep their relative order. An adaptive merge
+ * sort is used, which takes close to linear time if the vector consists of few sorted or strictly descending runs.
+ * Scratch memory for half the items is allocated from the vector's allocator.
+ * @return True iff OOM, in which case the vector is unmodified.
+ */
+bool axv_stableSort(axvector *v);
+/**
+ * Partially sort vector using its comparator: the k least items are moved to the front in sorted order, the order
+ * of the remaining items is unspecified. Takes O(n + k log k) time. The sort is not stable.
+ * @param k Number of items to sort. If it is not less than the length of the vector, the whole vector is sorted.
+ * @return Self.
+ */
+axvector *axv_partialSort(axvector *v, uint64_t k);
+/**
+ * Partially sort vector using its comparator such that the item at index is the one that would be there if the
+ * vector was sorted. No item before it compares greater and no item after it compares less. Takes O(n) time on
+ * average using introselect.
+ * @param index May be negative.
+ * @return True iff index out of range.
+ */
+bool axv_nthElement(axvector *v, int64_t index);
+/**
+ * Sort vector by an unsigned integer key using LSD radix sort. The key function is called exactly once per item and
+ * is passed the item itself. The comparator is not used. The sort is stable. Scratch memory for the keys is
+ * allocated from the vector's allocator.
+ * @param key Function returning the key of an item.
+ * @return True iff OOM, in which case the vector is unmodified.
+ */
+bool axv_sortByKey(axvector *v, uint64_t (*key)(const void *));
+/**
+ * Sort vector by a floating-point key using LSD radix sort. Keys are ordered as by the < operator, with -0.0
+ * before +0.0. NaNs with the sign bit set are put first, all other NaNs last. The key function is called exactly once
+ * per item and is passed the item itself. The comparator is not used. The sort is stable. Scratch memory for the keys
+ * is allocated from the vector's allocator.
+ * @param key Function returning the key of an item.
+ * @return True iff OOM, in which case the vector is unmodified.
+ */
+bool axv_sortByFloatKey(axvector *v, double (*key)(const void *));
 /**
  * Binary search the argument in the vector. Only applicable if vector is sorted. No check is done for this.
  * @param val Value to search using the vector's comparator.
@@ -362,7 +871,81 @@ static inline int64_t axv_binarySearch(axvector *v, void *val) {
     return found ? found - v->items : -1;
 }
 /**
- * Linear search the argument in the vector. Forward search is used.
+ * Find the first item not less than the argument. Only applicable if vector is sorted. No check is done for this.
+ * @param val Value to search using the vector's comparator.
+ * @return Index of the first item which does not compare less than the argument, or the length of the vector if
+ * there is no such item.
+ */
+int64_t axv_lowerBound(axvector *v, void *val);
+/**
+ * Find the first item greater than the argument. Only applicable if vector is sorted. No check is done for this.
+ * @param val Value to search using the vector's comparator.
+ * @return Index of the first item which compares greater than the argument, or the length of the vector if there is
+ * no such item.
+ */
+int64_t axv_upperBound(axvector *v, void *val);
+/**
+ * Insert an item into a sorted vector, keeping it sorted. The item is inserted after all items comparing equal to
+ * it. Finding the spot takes O(log n), moving the items behind it O(n). The vector is resized as needed according
+ * to its growth policy.
+ * @param val Item.
+ * @return True iff OOM during resize operation. Item is not inserted in this case.
+ */
+bool axv_insertSorted(axvector *v, void *val);
+/**
+ * Remove the first item comparing equal to the argument from a sorted vector. If a destructor is set, it is called
+ * upon the removed item.
+ * @param val Value to search using the vector's comparator.
+ * @return True iff no item compares equal to the argument. Vector is unmodified in this case.
+ */
+bool axv_removeSorted(axvector *v, void *val);
+/**
+ * Merge all items of a sorted vector into another sorted vector using the first vector's comparator, keeping it
+ * sorted. Items comparing equal keep their order, with items of the first vector coming first. No changes are done to
+ * the second vector. The vectors may be the same. Takes O(n + m) by merging backwards from the end of the vectors.
+ * The first vector is resized as needed according to its growth policy.
+ * @param v1 Sorted vector to merge into.
+ * @param v2 Sorted vector to merge.
+ * @return True iff OOM during resize operation. The first vector is unmodified in this case.
+ */
+bool axv_mergeSorted(axvector *v1, axvector *v2);
+/**
+ * Remove all but the first item of every run of consecutive items comparing equal. On a sorted vector, this leaves
+ * every distinct item once. If a destructor is set, it is called upon all removed items.
+ * @return Self.
+ */
+axvector *axv_unique(axvector *v);
+/**
+ * Create a new vector of all items of the first sorted vector that also occur in the second sorted vector, using
+ * the first vector's comparator. An item occurring m times in the first and n times in the second vector occurs
+ * min(m, n) times in the result. Takes O(m + n), or O(m log(n / m)) if the second vector is much longer. The same
+ * holds for axv_union() and axv_difference(). The result uses the first vector's allocator. The comparator, hash
+ * function, growth policy and context are copied, the destructor is not.
+ * @param v1 First sorted vector.
+ * @param v2 Second sorted vector.
+ * @return New sorted axvector or NULL if OOM.
+ */
+axvector *axv_intersect(axvector *v1, axvector *v2);
+/**
+ * Create a new vector of all items occurring in either sorted vector, using the first vector's comparator. An item
+ * occurring m times in the first and n times in the second vector occurs max(m, n) times in the result, and items of
+ * the first vector are preferred. See axv_intersect().
+ * @param v1 First sorted vector.
+ * @param v2 Second sorted vector.
+ * @return New sorted axvector or NULL if OOM.
+ */
+axvector *axv_union(axvector *v1, axvector *v2);
+/**
+ * Create a new vector of all items of the first sorted vector that do not occur in the second sorted vector, using
+ * the first vector's comparator. An item occurring m times in the first and n times in the second vector occurs
+ * max(m - n, 0) times in the result. See axv_intersect().
+ * @param v1 First sorted vector.
+ * @param v2 Second sorted vector.
+ * @return New sorted axvector or NULL if OOM.
+ */
+axvector *axv_difference(axvector *v1, axvector *v2);
+/**
+ * Linear search the argument in the vector. Forward search is used, or the hash index if a hash function is set.
  * @param val Value to search using the vector's comparator.
  * @return Index of the first item which matches the argument or -1 if no such item is found.
  */
@@ -376,6 +959,49 @@ int64_t axv_linearSearch(axvector *v, void *val);
  * @return Self.
  */
 axvector *axv_setComparator(axvector *v, int (*cmp)(const void *, const void *));
+/**
+ * Set hash function for the hash index. It is passed the item itself and must return equal hashes for items
+ * comparing equal according to the comparator. The index is built on the next search. axv_hashAddress() fits the
+ * default comparator.
+ * @param hash Hash function or NULL to drop the index.
+ * @return Self.
+ */
+axvector *axv_setHash(axvector *v, uint64_t (*hash)(const void *));
+/**
+ * Get hash function.
+ * @return Hash function or NULL if none is set.
+ */
+static inline uint64_t (*axv_getHash(axvector *v))(const void *) {
+    return v->hash;
+}
+/**
+ * The default comparator. Compares the addresses of items, just as axv_setComparator(v, NULL) does, and enables
+ * the same fast paths.
+ * @param a Pointer to the first item.
+ * @param b Pointer to the second item.
+ * @return Negative, zero or positive int.
+ */
+int axv_compareAddress(const void *a, const void *b);
+/**
+ * Hash function matching the default comparator. Hashes the address of an item.
+ * @param item Item.
+ * @return Hash.
+ */
+uint64_t axv_hashAddress(const void *item);
+/**
+ * Mark the hash index stale, so it is rebuilt by the next search. Necessary after changing items through
+ * axv_data() or views while a hash function is set.
+ * @return Self.
+ */
+axvector *axv_touch(axvector *v);
+/**
+ * Remove all items comparing equal to an earlier item, keeping the first occurrence of each. The relative order of
+ * the remaining items is preserved. If a destructor is set, it is called upon all removed items. A temporary hash
+ * table is used, with the vector's hash function or, if none is set and the default comparator is active,
+ * axv_hashAddress(). Expected linear time.
+ * @return True iff OOM or there is no hash function to use. Vector is unmodified in this case.
+ */
+bool axv_dedupe(axvector *v);
 /**
  * Get comparator function. Type is int (*)(const void *, const void *).
  * @return Comparator.
@@ -399,6 +1025,24 @@ static inline axvector *axv_setDestructor(axvector *v, void (*destroy)(void *))
 static inline void (*axv_getDestructor(axvector *v))(void *) {
     return v->destroy;
 }
+/**
+ * Set batch destructor function. Type must match void (*)(void **, uint64_t, void *). It is called with
+ * (array of removed items, number of removed items, context of the vector) and takes precedence over the destructor.
+ * The array is only valid for the duration of the call.
+ * @param destroyBatch Batch destructor or NULL to fall back to the destructor.
+ * @return Self.
+ */
+static inline axvector *axv_setBatchDestructor(axvector *v, void (*destroyBatch)(void **, uint64_t, void *)) {
+    v->destroyBatch = destroyBatch;
+    return v;
+}
+/**
+ * Get batch destructor function. Type is void (*)(void **, uint64_t, void *).
+ * @return Batch destructor or NULL if not set.
+ */
+static inline void (*axv_getBatchDestructor(axvector *v))(void **, uint64_t, void *) {
+    return v->destroyBatch;
+}
 /**
  * Store a context in the vector.
  * @param context Context.
@@ -416,7 +1060,8 @@ static inline void *axv_getContext(axvector *v) {
     return v->context;
 }
 /**
- * Pointer to first item of this vector. This function is useful when you need raw array access.
+ * Pointer to first item of this vector. This function is useful when you need raw array access. The items are
+ * always contiguous, even after pushing and popping at the front.
  * @return The internal array of this vector.
  */
 static inline void **axv_data(axvector *v) {
@@ -456,20 +1101,95 @@ static inline bool axv_isLocked(axvector *v) {
     return v->locked;
 }
 /**
- * Check if this vector is an overlay.
+ * Enable or disable automatic shrinking. If enabled, axv_pop(), axv_discard(), axv_filter(), axv_filterBatch() and
+ * axv_clear() reduce the capacity to twice the length, but at least to AXV_INLINE_CAP, whenever they leave the vector
+ * less than a quarter full. Locked vectors and overlays are never shrunk. The setting is passed on to copies, slices
+ * and partitions along with the growth policy. Disabled by default.
+ * @param autoShrink True to enable, false to disable.
+ * @return Self.
+ */
+static inline axvector *axv_setAutoShrink(axvector *v, bool autoShrink) {
+    v->autoShrink = autoShrink;
+    return v;
+}
+/**
+ * Check if automatic shrinking is enabled.
+ * @return True if enabled, false if not.
+ */
+static inline bool axv_getAutoShrink(axvector *v) {
+    return v->autoShrink;
+}
+/**
+ * Set the growth policy. The policy is called with (current capacity, required capacity, param) whenever the vector
+ * has to grow and shall return the new capacity. Returning less than the required capacity is treated as returning
+ * the required capacity.
+ * @param grow Growth policy or NULL to activate the default policy (doubling).
+ * @param param Parameter passed to the policy.
+ * @return Self.
+ */
+axvector *axv_setGrowth(axvector *v, uint64_t (*grow)(uint64_t, uint64_t, uint64_t), uint64_t param);
+/**
+ * Geometric growth policy. The capacity is multiplied by a factor given in percent, plus one.
+ * A parameter of 200 (the default policy) doubles the capacity, 150 grows it by half.
+ * @param cap Current capacity.
+ * @param required Required capacity.
+ * @param percent Growth factor in percent.
+ * @return New capacity.
+ */
+uint64_t axv_growGeometric(uint64_t cap, uint64_t required, uint64_t percent);
+/**
+ * Linear growth policy. The capacity is increased by a fixed number of items.
+ * @param cap Current capacity.
+ * @param required Required capacity.
+ * @param step Increment.
+ * @return New capacity.
+ */
+uint64_t axv_growLinear(uint64_t cap, uint64_t required, uint64_t step);
+/**
+ * Check if this vector is an overlay, i.e. its internal array is caller-owned memory.
  * @return True if this vector is an overlay, false if not.
  */
 static inline bool axv_isOverlay(axvector *v) {
     return v->overlay;
 }
 /**
- * Set custom memory functions. All three of them must be set and be compatible with one another.
+ * Get the allocator of this vector.
+ * @return Allocator.
+ */
+static inline const axv_allocator *axv_getAllocator(axvector *v) {
+    return v->allocator;
+}
+/**
+ * Get the default allocator, which forwards to the memory functions set by axv_memoryfn().
+ * @return Default allocator.
+ */
+const axv_allocator *axv_defaultAllocator(void);
+/**
+ * Set custom memory functions used by all vectors that were not created with an allocator of their own.
+ * This affects all existing such vectors, so it should be done before any vector is created.
+ * All three of them must be set and be compatible with one another.
  * Passing NULL for any function will activate its standard library counterpart.
  * @param malloc_fn The malloc function.
  * @param realloc_fn The realloc function.
  * @param free_fn The free function.
  */
 void axv_memoryfn(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *));
+/**
+ * Get the library-wide statistics. They are only collected if the library is compiled with AXV_STATS defined (a
+ * compile-time option, off by default); otherwise all counters are 0 and collecting them costs nothing. Counters are
+ * updated atomically and cover every vector since the last reset:
+ * resizes is the number of times an item array was reallocated or moved to or from inline storage,
+ * reallocBytes the bytes of items that had to be preserved across these reallocations, an upper bound of what
+ * realloc copied,
+ * movedBytes the bytes of items moved or copied within and between vectors by any other function,
+ * comparisons the number of calls to comparators, including the default one where it is called rather than bypassed,
+ * destructions the number of items handed to destructors or batch destructors and
+ * maxCapacity the largest capacity, in items, any vector has had.
+ * Functions of axvparallel are not counted, apart from the items they destroy and the resizes of axv_pfilter().
+ * @param reset Whether to reset all counters to 0 after taking the snapshot.
+ * @return Snapshot of the counters.
+ */
+axv_statistics axv_stats(bool reset);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,329 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVECTOR_HPP
+#define AXVECTOR_AXVECTOR_HPP
+
+#include "axvector.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+/*
+    axvector.hpp is a header-only C++17 layer over axvector. It adds no state of its own: every object wraps an
+    axvector * and operates on the same struct, so vectors can be passed back and forth between C and C++ code freely.
+
+    axv::vector<T> owns a vector and destroys it with axv_destroy() when it goes out of scope. It can be moved but not
+    copied, use copy() or snapshot() to duplicate the items. axv::vectorRef<T> offers the same functions on a vector
+    it does not own, e.g. one created by C code. T is the type the void * items are converted to and from, which may
+    be an object or void pointer type or an integer or enum type no larger than a pointer.
+
+    sort(), filter(), map(), partition(), find() and count() take any callable, such as a lambda, on items of type T.
+    sort() takes a less-than predicate like std::sort() instead of a comparator returning an int. As the callables
+    are template arguments, the compiler can inline them into the loops over the items. Callables must not throw.
+
+    Functions that change items in place respect snapshots and the hash index like their C counterparts: they unshare
+    the array first and mark the index stale afterwards. Functions returning true iff an error occurred in C do so
+    here as well. Functions returning a new vector or NULL in C return an axv::vector or throw std::bad_alloc.
+
+    Iterators are random access and yield items of type T by value. Write items through set() or axv_data(), calling
+    axv_unshare() before and axv_touch() after the latter.
+*/
+namespace axv {
+
+namespace detail {
+
+template <class T>
+inline T fromItem(void *item) noexcept {
+    if constexpr (std::is_pointer<T>::value)
+        return static_cast<T>(item);
+    else
+        return static_cast<T>(reinterpret_cast<uintptr_t>(item));
+}
+
+
+template <class T>
+inline void *toItem(T val) noexcept {
+    if constexpr (std::is_pointer<T>::value)
+        return const_cast<void *>(static_cast<const volatile void *>(val));
+    else
+        return reinterpret_cast<void *>(static_cast<uintptr_t>(val));
+}
+
+
+inline axvector *checked(axvector *v) {
+    if (!v)
+        throw std::bad_alloc();
+    return v;
+}
+
+
+template <class T, class Pred>
+void keepBlock(void **items, uint64_t n, bool *keep, void *arg) {
+    Pred &pred = *static_cast<Pred *>(arg);
+    for (uint64_t i = 0; i < n; ++i)
+        keep[i] = pred(fromItem<T>(items[i]));
+}
+
+
+template <class T, class F>
+void mapBlock(void **items, uint64_t n, void *arg) {
+    F &f = *static_cast<F *>(arg);
+    for (uint64_t i = 0; i < n; ++i)
+        items[i] = toItem<T>(f(fromItem<T>(items[i])));
+}
+
+}
+
+
+template <class T>
+class iterator {
+    void **p;
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    iterator() noexcept : p(nullptr) {}
+    explicit iterator(void **p) noexcept : p(p) {}
+
+    T operator*() const noexcept { return detail::fromItem<T>(*p); }
+    T operator[](difference_type n) const noexcept { return detail::fromItem<T>(p[n]); }
+
+    iterator &operator++() noexcept { ++p; return *this; }
+    iterator &operator--() noexcept { --p; return *this; }
+    iterator operator++(int) noexcept { return iterator(p++); }
+    iterator operator--(int) noexcept { return iterator(p--); }
+    iterator &operator+=(difference_type n) noexcept { p += n; return *this; }
+    iterator &operator-=(difference_type n) noexcept { p -= n; return *this; }
+    iterator operator+(difference_type n) const noexcept { return iterator(p + n); }
+    iterator operator-(difference_type n) const noexcept { return iterator(p - n); }
+    friend iterator operator+(difference_type n, iterator it) noexcept { return it + n; }
+    difference_type operator-(iterator other) const noexcept { return p - other.p; }
+
+    bool operator==(iterator other) const noexcept { return p == other.p; }
+    bool operator!=(iterator other) const noexcept { return p != other.p; }
+    bool operator<(iterator other) const noexcept { return p < other.p; }
+    bool operator>(iterator other) const noexcept { return p > other.p; }
+    bool operator<=(iterator other) const noexcept { return p <= other.p; }
+    bool operator>=(iterator other) const noexcept { return p >= other.p; }
+};
+
+
+template <class T>
+class vector;
+
+
+template <class T = void *>
+class vectorRef {
+    static_assert(std::is_pointer<T>::value ? !std::is_function<typename std::remove_pointer<T>::type>::value
+                                            : ((std::is_integral<T>::value || std::is_enum<T>::value)
+                                               && sizeof(T) <= sizeof(void *)),
+                  "T must be an object or void pointer type or an integer or enum type no larger than a pointer");
+
+protected:
+    axvector *v;
+
+public:
+    /**
+     * Refer to a vector without taking ownership of it.
+     */
+    explicit vectorRef(axvector *v) noexcept : v(v) {}
+
+    /**
+     * The underlying vector, for use with the C functions.
+     */
+    axvector *get() const noexcept { return v; }
+
+    uint64_t size() const noexcept { return axv_ulen(v); }
+    bool empty() const noexcept { return v->len == 0; }
+    iterator<T> begin() const noexcept { return iterator<T>(v->items); }
+    iterator<T> end() const noexcept { return iterator<T>(v->items + v->len); }
+
+    /**
+     * Index vector directly. No bounds checking, no negative indexing.
+     */
+    T operator[](uint64_t index) const noexcept { return detail::fromItem<T>(v->items[index]); }
+    /**
+     * Index vector like axv_at().
+     * @param index May be negative.
+     * @return Item at index or T converted from NULL if index out of range.
+     */
+    T at(int64_t index) const noexcept { return detail::fromItem<T>(axv_at(v, index)); }
+    /**
+     * axv_set().
+     * @return True iff index out of range or OOM while unsharing.
+     */
+    bool set(int64_t index, T val) noexcept { return axv_set(v, index, detail::toItem<T>(val)); }
+    /**
+     * axv_push().
+     * @return True iff OOM.
+     */
+    bool push(T val) noexcept { return axv_push(v, detail::toItem<T>(val)); }
+    /**
+     * axv_pop().
+     * @return Removed item or T converted from NULL if the vector is empty.
+     */
+    T pop() noexcept { return detail::fromItem<T>(axv_pop(v)); }
+    /**
+     * axv_reserve().
+     * @return True iff OOM.
+     */
+    bool reserve(uint64_t n) noexcept { return axv_reserve(v, n); }
+    /**
+     * axv_clear().
+     */
+    void clear() noexcept { axv_clear(v); }
+
+    /**
+     * Sort the items in-place by a less-than predicate taking two items. Not stable. O(n log n).
+     * @return True iff OOM while unsharing. Vector is unmodified in this case.
+     */
+    template <class Less>
+    bool sort(Less less) noexcept {
+        if (axv_unshare(v))
+            return true;
+        std::sort(v->items, v->items + v->len,
+                  [&less](void *a, void *b) { return less(detail::fromItem<T>(a), detail::fromItem<T>(b)); });
+        axv_touch(v);
+        return false;
+    }
+    /**
+     * Sort the items in-place by the vector's comparator, like axv_sort().
+     * @return True iff OOM while unsharing.
+     */
+    bool sort() noexcept { return !axv_sort(v); }
+
+    /**
+     * Keep the items satisfying a predicate and remove all others, like axv_filter().
+     * @return True iff OOM while unsharing. Vector is unmodified in this case.
+     */
+    template <class Pred>
+    bool filter(Pred keep) noexcept {
+        return !axv_filterBatch(v, detail::keepBlock<T, Pred>, &keep);
+    }
+
+    /**
+     * Replace every item x by f(x), like axv_map(). Items are mapped linearly from first to last.
+     * @return True iff OOM while unsharing. Vector is unmodified in this case.
+     */
+    template <class F>
+    bool map(F f) noexcept {
+        return !axv_mapBatch(v, detail::mapBlock<T, F>, &f);
+    }
+
+    /**
+     * Keep the items satisfying a predicate and move all others to a new vector, like axv_partition().
+     * @return The new vector containing all rejected items.
+     * @throws std::bad_alloc If OOM, in which case no partitioning is done.
+     */
+    template <class Pred>
+    vector<T> partition(Pred keep);
+
+    /**
+     * Find the first item satisfying a predicate.
+     * @return Index of the item or -1 if no item satisfies the predicate.
+     */
+    template <class Pred>
+    int64_t find(Pred pred) const noexcept {
+        for (uint64_t i = 0; i < v->len; ++i) {
+            if (pred(detail::fromItem<T>(v->items[i])))
+                return static_cast<int64_t>(i);
+        }
+        return -1;
+    }
+
+    /**
+     * Count the items satisfying a predicate.
+     * @return Number of items.
+     */
+    template <class Pred>
+    uint64_t count(Pred pred) const noexcept {
+        uint64_t n = 0;
+        for (uint64_t i = 0; i < v->len; ++i)
+            n += static_cast<bool>(pred(detail::fromItem<T>(v->items[i])));
+        return n;
+    }
+};
+
+
+template <class T = void *>
+class vector : public vectorRef<T> {
+public:
+    /**
+     * Create an empty vector, like axv_new().
+     * @throws std::bad_alloc If OOM.
+     */
+    vector() : vectorRef<T>(detail::checked(axv_new())) {}
+    /**
+     * Create an empty vector, like axv_newWithAllocator().
+     * @throws std::bad_alloc If OOM.
+     */
+    explicit vector(uint64_t size, const axv_allocator *allocator = nullptr)
+        : vectorRef<T>(detail::checked(axv_newWithAllocator(size, allocator))) {}
+
+    /**
+     * Take ownership of a vector created by the C functions, e.g. axv_new() or axv_slice().
+     * @param v The vector. Must not be NULL.
+     */
+    static vector adopt(axvector *v) noexcept { return vector(v, 0); }
+
+    vector(vector &&other) noexcept : vectorRef<T>(other.v) { other.v = nullptr; }
+    vector &operator=(vector &&other) noexcept {
+        std::swap(this->v, other.v);
+        return *this;
+    }
+    vector(const vector &) = delete;
+    vector &operator=(const vector &) = delete;
+
+    /**
+     * Destroy the vector by axv_destroy(), unless it has been moved from or released.
+     */
+    ~vector() {
+        if (this->v)
+            axv_destroy(this->v);
+    }
+
+    /**
+     * Give up ownership of the vector.
+     * @return The vector, to be destroyed by axv_destroy().
+     */
+    axvector *release() noexcept {
+        axvector *v = this->v;
+        this->v = nullptr;
+        return v;
+    }
+
+    /**
+     * Copy the vector, like axv_copy().
+     * @throws std::bad_alloc If OOM.
+     */
+    vector copy() const { return adopt(detail::checked(axv_copy(this->v))); }
+    /**
+     * Create a vector sharing the array of this one until either changes, like axv_snapshot().
+     * @throws std::bad_alloc If OOM.
+     */
+    vector snapshot() const { return adopt(detail::checked(axv_snapshot(this->v))); }
+
+private:
+    vector(axvector *v, int) noexcept : vectorRef<T>(v) {}
+};
+
+
+template <class T>
+template <class Pred>
+vector<T> vectorRef<T>::partition(Pred keep) {
+    return vector<T>::adopt(detail::checked(axv_partitionBatch(v, detail::keepBlock<T, Pred>, &keep)));
+}
+
+}
+
+#endif //AXVECTOR_AXVECTOR_HPP
@@ -0,0 +1,153 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "axvio.h"
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AXV_UNIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MAGIC "axvector"
+#define BYTE_ORDER_MARK 0x0102030405060708
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define READ_CHUNK 65536
+
+
+typedef struct fileHeader {
+    char magic[8];
+    uint64_t order;
+    uint32_t itemSize;
+    uint32_t encoded;
+    uint64_t len;
+} fileHeader;
+
+
+static bool validHeader(const fileHeader *header, bool encoded) {
+    return memcmp(header->magic, MAGIC, sizeof header->magic) == 0 && header->order == BYTE_ORDER_MARK
+           && header->itemSize == sizeof(void *) && header->encoded == encoded
+           && header->len <= SIZE_MAX / sizeof(void *);
+}
+
+
+// true iff f is seekable and holds fewer than len raw items behind the current position
+static bool tooShort(FILE *f, uint64_t len) {
+    const long pos = ftell(f);
+    if (pos < 0 || fseek(f, 0, SEEK_END) != 0)
+        return false;
+    const long end = ftell(f);
+    if (end < pos || fseek(f, pos, SEEK_SET) != 0)
+        return true;
+    return (uint64_t) (end - pos) / sizeof(void *) < len;
+}
+
+
+bool axv_serialize(axvector *v, FILE *f, bool (*encode)(FILE *, const void *, void *), void *arg) {
+    fileHeader header = {{0}, BYTE_ORDER_MARK, sizeof(void *), encode != NULL, v->len};
+    memcpy(header.magic, MAGIC, sizeof header.magic);
+    if (fwrite(&header, sizeof header, 1, f) != 1)
+        return true;
+    if (!encode)
+        return fwrite(v->items, sizeof(void *), v->len, f) != v->len;
+    for (uint64_t i = 0; i < v->len; ++i) {
+        if (encode(f, v->items[i], arg))
+            return true;
+    }
+    return false;
+}
+
+
+axvector *axv_deserialize(FILE *f, bool (*decode)(FILE *, void **, void *), void *arg, void (*destroy)(void *),
+                          const axv_allocator *allocator) {
+    fileHeader header;
+    if (fread(&header, sizeof header, 1, f) != 1 || !validHeader(&header, decode != NULL))
+        return NULL;
+    if (!decode && tooShort(f, header.len))
+        return NULL;
+    axvector *v = axv_newWithAllocator(MIN(header.len, READ_CHUNK), allocator);
+    if (!v)
+        return NULL;
+    axv_setDestructor(v, destroy);
+    // the length is not trusted to size the vector, which grows chunk by chunk as the items are actually read
+    bool error = false;
+    while (!error && v->len < header.len) {
+        const uint64_t end = v->len + MIN(header.len - v->len, READ_CHUNK);
+        error = axv_reserve(v, end);
+        if (!error && !decode) {
+            error = fread(v->items + v->len, sizeof(void *), end - v->len, f) != end - v->len;
+            v->len = error ? v->len : end;
+        }
+        while (!error && decode && v->len < end) {
+            error = decode(f, v->items + v->len, arg);
+            v->len += !error;
+        }
+    }
+    if (error) {
+        axv_destroy(v);
+        return NULL;
+    }
+    return v;
+}
+
+
+bool axv_saveFile(axvector *v, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return true;
+    bool error = axv_serialize(v, f, NULL, NULL);
+    error |= fclose(f) != 0;
+    return error;
+}
+
+
+bool axv_mapFile(axvector *v, const char *path) {
+#ifdef AXV_UNIX
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return true;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(fileHeader)) {
+        close(fd);
+        return true;
+    }
+    void *base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return true;
+    const fileHeader *header = (const fileHeader *) base;
+    if (!validHeader(header, false) || header->len != (st.st_size - sizeof *header) / sizeof(void *)
+        || (st.st_size - sizeof *header) % sizeof(void *) != 0) {
+        munmap(base, (size_t) st.st_size);
+        return true;
+    }
+    *v = axv_newOverlay((void **) (header + 1), header->len, header->len);
+    return false;
+#else
+    (void) v; (void) path;
+    return true;
+#endif
+}
+
+
+void axv_unmapFile(axvector *v) {
+    const fileHeader *header = (const fileHeader *) (v->items - v->head) - 1;
+    const uint64_t size = sizeof *header + header->len * sizeof(void *);
+    axv_deinit(v);
+#ifdef AXV_UNIX
+    munmap((void *) header, (size_t) size);
+#else
+    (void) size;
+#endif
+}
@@ -0,0 +1,81 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVIO_H
+#define AXVECTOR_AXVIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "axvector.h"
+#include <stdio.h>
+
+/*
+    axvio saves vectors to and loads them from streams and files.
+
+    A saved vector consists of a 32 byte header followed by its items. The header records the number of items, the
+    size of a void * and the byte order of the machine that saved it, and whether the items were written raw or
+    encoded. Files can only be loaded on machines with the same pointer size and byte order.
+
+    Items are written raw if no encoder is given. This is meant for pointer-free payloads, i.e. integers stored in
+    the void * slots: the whole array is written with a single fwrite(), and a raw file can be mapped into memory by
+    axv_mapFile() without reading or copying it. Items that are pointers must be encoded instead. The encoder is
+    called for every item in order and writes it to the stream in any format it likes, and the decoder given when
+    loading reads it back.
+*/
+
+
+/**
+ * Write a vector to a stream.
+ * @param f Stream opened for writing in binary mode.
+ * @param encode Encoder taking (stream, item, arg) and returning true iff it failed, or NULL to write the items raw.
+ * @param arg Argument passed to the encoder.
+ * @return True iff an error occurred. The stream is left at an unspecified position in this case.
+ */
+bool axv_serialize(axvector *v, FILE *f, bool (*encode)(FILE *, const void *, void *), void *arg);
+/**
+ * Read a vector from a stream, as written by axv_serialize().
+ * @param f Stream opened for reading in binary mode, positioned at the header.
+ * @param decode Decoder taking (stream, where to store the item, arg) and returning true iff it failed. Must be
+ * NULL if and only if the items were written raw.
+ * @param arg Argument passed to the decoder.
+ * @param destroy Destructor of the new vector or NULL. If an error occurs, it is called upon all items decoded so
+ * far. A failing call of the decoder must not leave an item behind.
+ * @param allocator Allocator of the new vector or NULL to use the memory functions set by axv_memoryfn().
+ * @return New axvector with the items read or NULL if OOM, a read or decoding error occurred or the header does not
+ * match. The number of items recorded in the header is not trusted: the vector grows as items are actually read, and
+ * raw input from a seekable stream is rejected up front if it is shorter than the header claims.
+ */
+axvector *axv_deserialize(FILE *f, bool (*decode)(FILE *, void **, void *), void *arg, void (*destroy)(void *),
+                          const axv_allocator *allocator);
+/**
+ * Write a vector to a file with its items raw. The file is created or truncated.
+ * @param path Path of the file.
+ * @return True iff the file could not be written.
+ */
+bool axv_saveFile(axvector *v, const char *path);
+/**
+ * Map a file written raw into memory and make a vector an overlay over its items, without reading or copying them.
+ * Only the pages accessed are read from the file, on demand. The items are read-only, so the vector is locked and
+ * functions writing to the items must not be called on it. Removing items from the end is possible. Release the
+ * vector by axv_unmapFile() instead of axv_deinit(). Only available on unix systems.
+ * @param v Uninitialised vector, e.g. on the stack.
+ * @param path Path of the file.
+ * @return True iff the file could not be opened or mapped or its header does not match. v is not initialised in
+ * this case.
+ */
+bool axv_mapFile(axvector *v, const char *path);
+/**
+ * Release a vector created by axv_mapFile() and unmap its file. If a destructor is set, it is called upon all items.
+ */
+void axv_unmapFile(axvector *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AXVECTOR_AXVIO_H
@@ -0,0 +1,471 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+
+#include "axvparallel.h"
+#include "axvsort.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define DESTROY_BATCH 64
+
+
+static void poolRun(axv_task task, void *arg, uint64_t n, void *ctx);
+
+static void (*run_)(axv_task task, void *arg, uint64_t n, void *ctx) = poolRun;
+static void *runContext_ = NULL;
+
+
+static struct {
+    pthread_mutex_t submit;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t *threads;
+    unsigned nthreads;
+    unsigned active;
+    uint64_t generation;
+    bool stop;
+    axv_task task;
+    void *arg;
+    uint64_t n;
+    atomic_uint_fast64_t next;
+} pool = {
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
+
+
+static void drainTasks(void) {
+    uint64_t i;
+    while ((i = atomic_fetch_add_explicit(&pool.next, 1, memory_order_relaxed)) < pool.n)
+        pool.task(pool.arg, i);
+}
+
+
+static void *poolWorker(void *unused) {
+    (void) unused;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen && !pool.stop)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        if (pool.stop)
+            break;
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+        drainTasks();
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.active == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+
+static void poolRun(axv_task task, void *arg, uint64_t n, void *ctx) {
+    (void) ctx;
+    pthread_mutex_lock(&pool.submit);
+    if (pool.nthreads == 0 || n < 2) {
+        for (uint64_t i = 0; i < n; ++i)
+            task(arg, i);
+        pthread_mutex_unlock(&pool.submit);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.task = task;
+    pool.arg = arg;
+    pool.n = n;
+    atomic_store_explicit(&pool.next, 0, memory_order_relaxed);
+    pool.active = pool.nthreads;
+    ++pool.generation;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    drainTasks();
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.submit);
+}
+
+
+void axv_poolStop(void) {
+    pthread_mutex_lock(&pool.submit);
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned i = 0; i < pool.nthreads; ++i)
+        pthread_join(pool.threads[i], NULL);
+    free(pool.threads);
+    pool.threads = NULL;
+    pool.nthreads = 0;
+    pool.stop = false;
+    pthread_mutex_unlock(&pool.submit);
+}
+
+
+bool axv_poolStart(unsigned threads) {
+    axv_poolStop();
+    if (threads < 2)
+        return false;
+    pthread_mutex_lock(&pool.submit);
+    pool.threads = malloc((threads - 1) * sizeof *pool.threads);
+    if (!pool.threads) {
+        pthread_mutex_unlock(&pool.submit);
+        return true;
+    }
+    pthread_mutex_lock(&pool.lock);
+    for (; pool.nthreads < threads - 1; ++pool.nthreads) {
+        if (pthread_create(pool.threads + pool.nthreads, NULL, poolWorker, NULL))
+            break;
+    }
+    pthread_mutex_unlock(&pool.lock);
+    const bool failed = pool.nthreads < threads - 1;
+    pthread_mutex_unlock(&pool.submit);
+    if (failed)
+        axv_poolStop();
+    return failed;
+}
+
+
+void axv_executorfn(void (*run)(axv_task task, void *arg, uint64_t n, void *ctx), void *ctx) {
+    run_ = run ? run : poolRun;
+    runContext_ = run ? ctx : NULL;
+}
+
+
+static uint64_t chunkCount(axvector *v) {
+    return (v->len + AXV_PARALLEL_CHUNK - 1) / AXV_PARALLEL_CHUNK;
+}
+
+
+static uint64_t chunkBegin(uint64_t chunk) {
+    return chunk * AXV_PARALLEL_CHUNK;
+}
+
+
+static uint64_t chunkEnd(axvector *v, uint64_t chunk) {
+    return MIN(v->len, (chunk + 1) * AXV_PARALLEL_CHUNK);
+}
+
+
+typedef struct mapJob {
+    axvector *v;
+    void *(*f)(void *, void *);
+    void *arg;
+} mapJob;
+
+
+static void mapTask(void *arg, uint64_t chunk) {
+    mapJob *job = arg;
+    void **val = job->v->items + chunkBegin(chunk);
+    void **bound = job->v->items + chunkEnd(job->v, chunk);
+    while (val < bound) {
+        *val = job->f(*val, job->arg);
+        ++val;
+    }
+}
+
+
+axvector *axv_pmap(axvector *v, void *(*f)(void *, void *), void *arg) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_map(v, f, arg);
+    if (axv_unshare(v))
+        return NULL;
+    axv_touch(v);
+    mapJob job = {v, f, arg};
+    run_(mapTask, &job, chunkCount(v), runContext_);
+    return v;
+}
+
+
+typedef struct predicateJob {
+    axvector *v;
+    bool (*f)(const void *, void *);
+    void *arg;
+    uint64_t *counts;
+    atomic_bool decided;
+} predicateJob;
+
+
+static void filterTask(void *arg, uint64_t chunk) {
+    predicateJob *job = arg;
+    axvector *v = job->v;
+    const uint64_t begin = chunkBegin(chunk);
+    const uint64_t end = chunkEnd(v, chunk);
+    void *dead[DESTROY_BATCH];
+    uint64_t len = begin, ndead = 0;
+    for (uint64_t i = begin; i < end; ++i) {
+        if (job->f(v->items[i], job->arg)) {
+            v->items[len++] = v->items[i];
+        } else if (v->destroy || v->destroyBatch) {
+            dead[ndead++] = v->items[i];
+            if (ndead == DESTROY_BATCH) {
+                axv_destroyItems_(v, dead, ndead);
+                ndead = 0;
+            }
+        }
+    }
+    axv_destroyItems_(v, dead, ndead);
+    job->counts[chunk] = len - begin;
+}
+
+
+axvector *axv_pfilter(axvector *v, bool (*f)(const void *, void *), void *arg) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_filter(v, f, arg);
+    if (axv_unshare(v))
+        return NULL;
+    const uint64_t chunks = chunkCount(v);
+    uint64_t *counts = v->allocator->alloc(chunks * sizeof *counts, v->allocator->ctx);
+    if (!counts)
+        return axv_filter(v, f, arg);
+    axv_touch(v);
+
+    predicateJob job = {v, f, arg, counts, false};
+    run_(filterTask, &job, chunks, runContext_);
+
+    uint64_t len = counts[0];
+    for (uint64_t chunk = 1; chunk < chunks; ++chunk) {
+        memmove(v->items + len, v->items + chunkBegin(chunk), counts[chunk] * sizeof *v->items);
+        len += counts[chunk];
+    }
+    v->len = len;
+    v->allocator->free(counts, chunks * sizeof *counts, v->allocator->ctx);
+    axv_autoShrink_(v);
+    return v;
+}
+
+
+static void anyTask(void *arg, uint64_t chunk) {
+    predicateJob *job = arg;
+    const uint64_t end = chunkEnd(job->v, chunk);
+    for (uint64_t i = chunkBegin(chunk); i < end; ++i) {
+        if ((i & 1023) == 0 && atomic_load_explicit(&job->decided, memory_order_relaxed))
+            return;
+        if (job->f(job->v->items[i], job->arg)) {
+            atomic_store_explicit(&job->decided, true, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+
+static void allTask(void *arg, uint64_t chunk) {
+    predicateJob *job = arg;
+    const uint64_t end = chunkEnd(job->v, chunk);
+    for (uint64_t i = chunkBegin(chunk); i < end; ++i) {
+        if ((i & 1023) == 0 && atomic_load_explicit(&job->decided, memory_order_relaxed))
+            return;
+        if (!job->f(job->v->items[i], job->arg)) {
+            atomic_store_explicit(&job->decided, true, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+
+bool axv_pany(axvector *v, bool (*f)(const void *, void *), void *arg) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_any(v, f, arg);
+    predicateJob job = {v, f, arg, NULL, false};
+    run_(anyTask, &job, chunkCount(v), runContext_);
+    return atomic_load(&job.decided);
+}
+
+
+bool axv_pall(axvector *v, bool (*f)(const void *, void *), void *arg) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_all(v, f, arg);
+    predicateJob job = {v, f, arg, NULL, false};
+    run_(allTask, &job, chunkCount(v), runContext_);
+    return !atomic_load(&job.decided);
+}
+
+
+typedef struct reduceJob {
+    axvector *v;
+    void *val;
+    void **results;
+    uint64_t *counts;
+} reduceJob;
+
+
+static void countTask(void *arg, uint64_t chunk) {
+    reduceJob *job = arg;
+    axvector *v = job->v;
+    uint64_t n = 0;
+    void **curr = v->items + chunkBegin(chunk);
+    void **bound = v->items + chunkEnd(v, chunk);
+    if (v->cmp == axv_compareAddress) {
+        while (curr < bound)
+            n += *curr++ == job->val;
+    } else {
+        while (curr < bound)
+            n += v->cmp(&job->val, curr++) == 0;
+    }
+    job->counts[chunk] = n;
+}
+
+
+uint64_t axv_pcount(axvector *v, void *val) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_count(v, val);
+    const uint64_t chunks = chunkCount(v);
+    uint64_t *counts = v->allocator->alloc(chunks * sizeof *counts, v->allocator->ctx);
+    if (!counts)
+        return axv_count(v, val);
+    reduceJob job = {v, val, NULL, counts};
+    run_(countTask, &job, chunks, runContext_);
+    uint64_t n = 0;
+    for (uint64_t chunk = 0; chunk < chunks; ++chunk)
+        n += counts[chunk];
+    v->allocator->free(counts, chunks * sizeof *counts, v->allocator->ctx);
+    return n;
+}
+
+
+static void maxTask(void *arg, uint64_t chunk) {
+    reduceJob *job = arg;
+    axvector *v = job->v;
+    const uint64_t end = chunkEnd(v, chunk);
+    void *max = v->items[chunkBegin(chunk)];
+    if (v->cmp == axv_compareAddress) {
+        for (uint64_t i = chunkBegin(chunk) + 1; i < end; ++i)
+            max = AXV_COMPARE_ADDRESSES(v->items[i], max) > 0 ? v->items[i] : max;
+    } else {
+        for (uint64_t i = chunkBegin(chunk) + 1; i < end; ++i) {
+            if (v->cmp(v->items + i, &max) > 0)
+                max = v->items[i];
+        }
+    }
+    job->results[chunk] = max;
+}
+
+
+static void minTask(void *arg, uint64_t chunk) {
+    reduceJob *job = arg;
+    axvector *v = job->v;
+    const uint64_t end = chunkEnd(v, chunk);
+    void *min = v->items[chunkBegin(chunk)];
+    if (v->cmp == axv_compareAddress) {
+        for (uint64_t i = chunkBegin(chunk) + 1; i < end; ++i)
+            min = AXV_COMPARE_ADDRESSES(v->items[i], min) < 0 ? v->items[i] : min;
+    } else {
+        for (uint64_t i = chunkBegin(chunk) + 1; i < end; ++i) {
+            if (v->cmp(v->items + i, &min) < 0)
+                min = v->items[i];
+        }
+    }
+    job->results[chunk] = min;
+}
+
+
+void *axv_pmax(axvector *v) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_max(v);
+    const uint64_t chunks = chunkCount(v);
+    axvector *results = axv_newWithAllocator(chunks, v->allocator);
+    if (!results)
+        return axv_max(v);
+    reduceJob job = {v, NULL, results->items, NULL};
+    run_(maxTask, &job, chunks, runContext_);
+    results->len = chunks;
+    axv_setComparator(results, v->cmp);
+    void *max = axv_max(results);
+    axv_destroy(results);
+    return max;
+}
+
+
+void *axv_pmin(axvector *v) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_min(v);
+    const uint64_t chunks = chunkCount(v);
+    axvector *results = axv_newWithAllocator(chunks, v->allocator);
+    if (!results)
+        return axv_min(v);
+    reduceJob job = {v, NULL, results->items, NULL};
+    run_(minTask, &job, chunks, runContext_);
+    results->len = chunks;
+    axv_setComparator(results, v->cmp);
+    void *min = axv_min(results);
+    axv_destroy(results);
+    return min;
+}
+
+
+typedef struct sortJob {
+    axvector *v;
+    void **src;
+    void **dst;
+    uint64_t width;
+} sortJob;
+
+
+static void sortTask(void *arg, uint64_t chunk) {
+    sortJob *job = arg;
+    axv_sortItems_(job->v, job->v->items + chunkBegin(chunk), chunkEnd(job->v, chunk) - chunkBegin(chunk));
+}
+
+
+static void mergeTask(void *arg, uint64_t pair) {
+    sortJob *job = arg;
+    int (*cmp)(const void *, const void *) = job->v->cmp;
+    const uint64_t len = job->v->len;
+    const uint64_t lo = pair * 2 * job->width;
+    const uint64_t mid = MIN(len, lo + job->width);
+    const uint64_t hi = MIN(len, mid + job->width);
+    void **l = job->src + lo, **lbound = job->src + mid;
+    void **r = job->src + mid, **rbound = job->src + hi;
+    void **out = job->dst + lo;
+    if (cmp == axv_compareAddress) {
+        while (l < lbound && r < rbound)
+            *out++ = AXV_COMPARE_ADDRESSES(*r, *l) < 0 ? *r++ : *l++;
+    } else {
+        while (l < lbound && r < rbound)
+            *out++ = cmp(r, l) < 0 ? *r++ : *l++;
+    }
+    memcpy(out, l, (lbound - l) * sizeof *l);
+    out += lbound - l;
+    memcpy(out, r, (rbound - r) * sizeof *r);
+}
+
+
+axvector *axv_psort(axvector *v) {
+    if (v->len < AXV_PARALLEL_THRESHOLD)
+        return axv_sort(v);
+    if (axv_unshare(v))
+        return NULL;
+    axvector *scratch = axv_newWithAllocator(v->len, v->allocator);
+    if (!scratch)
+        return axv_sort(v);
+    axv_touch(v);
+
+    sortJob job = {v, v->items, scratch->items, AXV_PARALLEL_CHUNK};
+    run_(sortTask, &job, chunkCount(v), runContext_);
+    for (; job.width < v->len; job.width *= 2) {
+        const uint64_t pairs = (v->len + 2 * job.width - 1) / (2 * job.width);
+        run_(mergeTask, &job, pairs, runContext_);
+        void **tmp = job.src;
+        job.src = job.dst;
+        job.dst = tmp;
+    }
+    if (job.src != v->items)
+        memcpy(v->items, job.src, v->len * sizeof *v->items);
+    axv_destroy(scratch);
+    return v;
+}
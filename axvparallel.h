@@ -0,0 +1,125 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVPARALLEL_H
+#define AXVECTOR_AXVPARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "axvector.h"
+
+/*
+    axvparallel provides parallel counterparts of some linear axvector operations. The vector is split into chunks of
+    AXV_PARALLEL_CHUNK items, each chunk is a task, and the tasks are handed to an executor. Vectors shorter than
+    AXV_PARALLEL_THRESHOLD items always take the serial path.
+
+    Chunk boundaries depend only on the length of the vector, never on the number of threads, and partial results are
+    always combined in chunk order. All results are therefore deterministic and equal to those of the serial functions,
+    except that axv_psort() may order items comparing equal differently from axv_sort().
+
+    The executor is pluggable. It is a function run(task, arg, n, ctx) that must call task(arg, i) exactly once for
+    every i in [0, n), possibly concurrently and in any order, and may only return once all calls have returned.
+    It is set once, in the spirit of axv_memoryfn(), by axv_executorfn(). If no executor is set, the built-in thread
+    pool is used, which can be started using axv_poolStart(). If the pool is not running either, everything runs on
+    the calling thread.
+
+    Callbacks passed to the parallel functions (predicates, map functions, comparators and destructors) are called
+    concurrently from multiple threads and hence must be thread-safe. None of the parallel functions may be called
+    from within such a callback.
+*/
+
+#ifndef AXV_PARALLEL_THRESHOLD
+#define AXV_PARALLEL_THRESHOLD 65536
+#endif
+
+#ifndef AXV_PARALLEL_CHUNK
+#define AXV_PARALLEL_CHUNK 16384
+#endif
+
+/**
+ * A task of a parallel operation. Takes (task argument, task index).
+ */
+typedef void (*axv_task)(void *, uint64_t);
+
+/**
+ * Set the executor used by all parallel functions.
+ * @param run The executor or NULL to activate the built-in thread pool.
+ * @param ctx An optional argument passed to the executor.
+ */
+void axv_executorfn(void (*run)(axv_task task, void *arg, uint64_t n, void *ctx), void *ctx);
+/**
+ * Start the built-in thread pool. The calling thread of a parallel function always takes part in the work, so
+ * threads - 1 worker threads are created. If the pool is already running, it is restarted.
+ * @param threads Total number of threads working on a parallel operation.
+ * @return True iff the worker threads could not be created, in which case the pool is not running.
+ */
+bool axv_poolStart(unsigned threads);
+/**
+ * Stop the built-in thread pool and join all of its worker threads. Does nothing if the pool is not running.
+ */
+void axv_poolStop(void);
+/**
+ * Parallel version of axv_map().
+ * @param f Function taking an item and returning whatever to overwrite its spot in the vector with.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axvector *axv_pmap(axvector *v, void *(*f)(void *, void *), void *arg);
+/**
+ * Parallel version of axv_filter(). The relative order of the remaining items is preserved. Chunks are filtered in
+ * parallel, then the surviving items of all chunks are moved together using prefix sums over the per-chunk counts.
+ * Removed items are destroyed and the automatic shrink policy is applied like in axv_filter().
+ * @param f Some predicate to filter the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return Self.
+ */
+axvector *axv_pfilter(axvector *v, bool (*f)(const void *, void *), void *arg);
+/**
+ * Parallel version of axv_sort(). Chunks are sorted in parallel, then merged pairwise in parallel rounds. If the
+ * scratch buffer for merging cannot be allocated, the vector is sorted serially instead.
+ * @return Self.
+ */
+axvector *axv_psort(axvector *v);
+/**
+ * Parallel version of axv_count().
+ * @param val The value all items are to be compared against.
+ * @return The resulting count.
+ */
+uint64_t axv_pcount(axvector *v, void *val);
+/**
+ * Parallel version of axv_any(). Unlike axv_any(), the predicate may be called on items past the first one to
+ * satisfy it.
+ * @param f Some predicate to apply to the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff any item satisfies the predicate.
+ */
+bool axv_pany(axvector *v, bool (*f)(const void *, void *), void *arg);
+/**
+ * Parallel version of axv_all(). Unlike axv_all(), the predicate may be called on items past the first one not to
+ * satisfy it.
+ * @param f Some predicate to apply to the vector.
+ * @param arg An optional argument passed to the predicate.
+ * @return True iff all items satisfy the predicate.
+ */
+bool axv_pall(axvector *v, bool (*f)(const void *, void *), void *arg);
+/**
+ * Parallel version of axv_max(). Returns the same item as axv_max().
+ * @return The greatest item or NULL if the vector is empty.
+ */
+void *axv_pmax(axvector *v);
+/**
+ * Parallel version of axv_min(). Returns the same item as axv_min().
+ * @return The least item or NULL if the vector is empty.
+ */
+void *axv_pmin(axvector *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AXVECTOR_AXVPARALLEL_H
@@ -0,0 +1,476 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+
+#include "axvpersistent.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define BITS 5
+#define WIDTH (1 << BITS)
+#define MASK (WIDTH - 1)
+
+
+/*
+    Leaves hold items, inner nodes hold nodes. The root is a leaf at shift 0 as long as the trie holds 32 items or
+    fewer, and NULL if it holds none. Every operation draws a fresh edit token, and nodes it created carry that
+    token, which allows it to change them in place. Nodes with any other token belong to existing versions and are
+    copied instead.
+*/
+typedef struct pnode {
+    atomic_uint_fast64_t refs;
+    uint64_t edit;
+    void *slots[WIDTH];
+} pnode;
+
+
+struct axpvector {
+    const axv_allocator *allocator;
+    uint64_t len;
+    unsigned shift;
+    pnode *root;
+    pnode *tail;
+};
+
+
+static atomic_uint_fast64_t edits = 1;
+
+
+static uint64_t newEdit(void) {
+    return atomic_fetch_add_explicit(&edits, 1, memory_order_relaxed);
+}
+
+
+static uint64_t normaliseIndex(uint64_t len, int64_t index) {
+    return index + (index < 0) * len;
+}
+
+
+static uint64_t tailOffset(const axpvector *p) {
+    return p->len < WIDTH ? 0 : (p->len - 1) >> BITS << BITS;
+}
+
+
+static pnode *newNode(const axv_allocator *allocator, uint64_t edit) {
+    pnode *n = allocator->alloc(sizeof *n, allocator->ctx);
+    if (!n)
+        return NULL;
+    atomic_init(&n->refs, 1);
+    n->edit = edit;
+    memset(n->slots, 0, sizeof n->slots);
+    return n;
+}
+
+
+static pnode *retain(pnode *n) {
+    if (n)
+        atomic_fetch_add_explicit(&n->refs, 1, memory_order_relaxed);
+    return n;
+}
+
+
+static void release(const axv_allocator *allocator, pnode *n, unsigned level) {
+    if (!n || atomic_fetch_sub_explicit(&n->refs, 1, memory_order_acq_rel) != 1)
+        return;
+    if (level > 0) {
+        for (unsigned i = 0; i < WIDTH; ++i)
+            release(allocator, n->slots[i], level - BITS);
+    }
+    allocator->free(n, sizeof *n, allocator->ctx);
+}
+
+
+// n itself if the current operation created it, otherwise a copy referencing the same children
+static pnode *editable(const axv_allocator *allocator, pnode *n, unsigned level, uint64_t edit) {
+    if (n->edit == edit)
+        return n;
+    pnode *m = newNode(allocator, edit);
+    if (!m)
+        return NULL;
+    memcpy(m->slots, n->slots, sizeof m->slots);
+    if (level > 0) {
+        for (unsigned i = 0; i < WIDTH; ++i)
+            retain(m->slots[i]);
+    }
+    return m;
+}
+
+
+static axpvector *newVersion(const axv_allocator *allocator) {
+    axpvector *p = allocator->alloc(sizeof *p, allocator->ctx);
+    if (!p)
+        return NULL;
+    p->allocator = allocator;
+    p->len = 0;
+    p->shift = 0;
+    p->root = NULL;
+    p->tail = NULL;
+    return p;
+}
+
+
+static axpvector *startVersion(axpvector *p) {
+    axpvector *q = newVersion(p->allocator);
+    if (!q)
+        return NULL;
+    q->len = p->len;
+    q->shift = p->shift;
+    q->root = retain(p->root);
+    q->tail = retain(p->tail);
+    return q;
+}
+
+
+// a chain of inner nodes down to level 0 ending in leaf, which is only taken over on success
+static pnode *newPath(const axv_allocator *allocator, unsigned level, pnode *leaf, uint64_t edit) {
+    if (level == 0)
+        return leaf;
+    pnode *n = newNode(allocator, edit);
+    if (!n)
+        return NULL;
+    n->slots[0] = newPath(allocator, level - BITS, leaf, edit);
+    if (!n->slots[0]) {
+        allocator->free(n, sizeof *n, allocator->ctx);
+        return NULL;
+    }
+    return n;
+}
+
+
+// append leaf as the leaf holding the items from index on, level being at least BITS
+static pnode *pushTail(const axv_allocator *allocator, pnode *n, unsigned level, uint64_t index, pnode *leaf,
+                       uint64_t edit) {
+    pnode *m = editable(allocator, n, level, edit);
+    if (!m)
+        return NULL;
+    const unsigned sub = (index >> level) & MASK;
+    pnode *child = m->slots[sub];
+    pnode *newChild;
+    if (level == BITS)
+        newChild = leaf;
+    else if (child)
+        newChild = pushTail(allocator, child, level - BITS, index, leaf, edit);
+    else
+        newChild = newPath(allocator, level - BITS, leaf, edit);
+    if (!newChild) {
+        if (m != n)
+            release(allocator, m, level);
+        return NULL;
+    }
+    if (child != newChild)
+        release(allocator, child, level - BITS);
+    m->slots[sub] = newChild;
+    return m;
+}
+
+
+// move the full tail of q into the trie
+static bool pushLeaf(axpvector *q, uint64_t edit) {
+    const axv_allocator *allocator = q->allocator;
+    const uint64_t index = q->len - WIDTH;
+    if (!q->root) {
+        q->root = q->tail;
+        q->shift = 0;
+    } else if (index == (uint64_t) WIDTH << q->shift) {
+        pnode *root = newNode(allocator, edit);
+        if (!root)
+            return true;
+        root->slots[1] = newPath(allocator, q->shift, q->tail, edit);
+        if (!root->slots[1]) {
+            allocator->free(root, sizeof *root, allocator->ctx);
+            return true;
+        }
+        root->slots[0] = q->root;
+        q->root = root;
+        q->shift += BITS;
+    } else {
+        pnode *root = pushTail(allocator, q->root, q->shift, index, q->tail, edit);
+        if (!root)
+            return true;
+        if (root != q->root)
+            release(allocator, q->root, q->shift);
+        q->root = root;
+    }
+    q->tail = NULL;
+    return false;
+}
+
+
+static bool appendItems(axpvector *q, void **src, uint64_t n, uint64_t edit) {
+    const axv_allocator *allocator = q->allocator;
+    while (n > 0) {
+        uint64_t count = q->len - tailOffset(q);
+        if (count == WIDTH) {
+            if (pushLeaf(q, edit))
+                return true;
+            count = 0;
+        }
+        pnode *tail = q->tail ? editable(allocator, q->tail, 0, edit) : newNode(allocator, edit);
+        if (!tail)
+            return true;
+        if (tail != q->tail)
+            release(allocator, q->tail, 0);
+        q->tail = tail;
+        const uint64_t m = MIN(WIDTH - count, n);
+        memcpy(tail->slots + count, src, m * sizeof *src);
+        q->len += m;
+        src += m;
+        n -= m;
+    }
+    return false;
+}
+
+
+static pnode *leafNode(axpvector *p, uint64_t index) {
+    if (index >= tailOffset(p))
+        return p->tail;
+    pnode *n = p->root;
+    for (unsigned level = p->shift; level > 0; level -= BITS)
+        n = n->slots[(index >> level) & MASK];
+    return n;
+}
+
+
+// the slots of the leaf holding the item at index
+static void **leafFor(axpvector *p, uint64_t index) {
+    return leafNode(p, index)->slots;
+}
+
+
+// append the items of p from index i1 to index i2 to q
+static bool appendRange(axpvector *q, axpvector *p, uint64_t i1, uint64_t i2, uint64_t edit) {
+    while (i1 < i2) {
+        const uint64_t offset = i1 & MASK;
+        const uint64_t m = MIN(WIDTH - offset, i2 - i1);
+        if (appendItems(q, leafFor(p, i1) + offset, m, edit))
+            return true;
+        i1 += m;
+    }
+    return false;
+}
+
+
+axpvector *axpv_new(const axv_allocator *allocator) {
+    return newVersion(allocator ? allocator : axv_defaultAllocator());
+}
+
+
+axpvector *axpv_fromVector(axvector *v) {
+    axpvector *q = newVersion(axv_getAllocator(v));
+    if (!q)
+        return NULL;
+    if (appendItems(q, axv_data(v), axv_ulen(v), newEdit())) {
+        axpv_destroy(q);
+        return NULL;
+    }
+    return q;
+}
+
+
+axvector *axpv_toVector(axpvector *p) {
+    axvector *v = axv_newWithAllocator(p->len, p->allocator);
+    if (!v)
+        return NULL;
+    for (uint64_t i = 0; i < p->len; i += WIDTH)
+        memcpy(v->items + i, leafFor(p, i), MIN(WIDTH, p->len - i) * sizeof *v->items);
+    v->len = p->len;
+    return v;
+}
+
+
+axpvector *axpv_copy(axpvector *p) {
+    return startVersion(p);
+}
+
+
+void axpv_destroy(axpvector *p) {
+    const axv_allocator *allocator = p->allocator;
+    release(allocator, p->root, p->shift);
+    release(allocator, p->tail, 0);
+    allocator->free(p, sizeof *p, allocator->ctx);
+}
+
+
+uint64_t axpv_len(axpvector *p) {
+    return p->len;
+}
+
+
+void *axpv_at(axpvector *p, int64_t index) {
+    uint64_t i = normaliseIndex(p->len, index);
+    return i < p->len ? leafFor(p, i)[i & MASK] : NULL;
+}
+
+
+axpvector *axpv_push(axpvector *p, void *val) {
+    return axpv_pushN(p, &val, 1);
+}
+
+
+axpvector *axpv_pushN(axpvector *p, void **src, uint64_t n) {
+    axpvector *q = startVersion(p);
+    if (!q)
+        return NULL;
+    if (appendItems(q, src, n, newEdit())) {
+        axpv_destroy(q);
+        return NULL;
+    }
+    return q;
+}
+
+
+/*
+    The trie without its last leaf, index being that of its last item. Returns NULL if the subtrie becomes empty,
+    which is told apart from OOM by *oom.
+*/
+static pnode *popTail(const axv_allocator *allocator, pnode *n, unsigned level, uint64_t index, uint64_t edit,
+                      bool *oom) {
+    const unsigned sub = (index >> level) & MASK;
+    pnode *child = NULL;
+    if (level > BITS) {
+        child = popTail(allocator, n->slots[sub], level - BITS, index, edit, oom);
+        if (*oom)
+            return NULL;
+    }
+    if (!child && sub == 0)
+        return NULL;
+    pnode *m = editable(allocator, n, level, edit);
+    if (!m) {
+        release(allocator, child, level - BITS);
+        *oom = true;
+        return NULL;
+    }
+    release(allocator, m->slots[sub], level - BITS);
+    m->slots[sub] = child;
+    return m;
+}
+
+
+axpvector *axpv_pop(axpvector *p) {
+    if (p->len <= 1)
+        return p->len ? axpv_new(p->allocator) : startVersion(p);
+    axpvector *q = startVersion(p);
+    if (!q)
+        return NULL;
+    const uint64_t edit = newEdit();
+    const axv_allocator *allocator = q->allocator;
+    const uint64_t offset = tailOffset(q);
+    if (q->len - offset > 1) {
+        pnode *tail = editable(allocator, q->tail, 0, edit);
+        if (!tail) {
+            axpv_destroy(q);
+            return NULL;
+        }
+        tail->slots[q->len - offset - 1] = NULL;
+        if (tail != q->tail)
+            release(allocator, q->tail, 0);
+        q->tail = tail;
+        --q->len;
+        return q;
+    }
+
+    pnode *tail = retain(leafNode(q, offset - 1));
+    pnode *root = NULL;
+    unsigned shift = 0;
+    if (offset > WIDTH) {
+        bool oom = false;
+        root = popTail(allocator, q->root, q->shift, offset - 1, edit, &oom);
+        if (oom) {
+            release(allocator, tail, 0);
+            axpv_destroy(q);
+            return NULL;
+        }
+        shift = q->shift;
+        if (!root->slots[1]) {
+            pnode *child = retain(root->slots[0]);
+            release(allocator, root, shift);
+            root = child;
+            shift -= BITS;
+        }
+    }
+    release(allocator, q->root, q->shift);
+    release(allocator, q->tail, 0);
+    q->root = root;
+    q->shift = shift;
+    q->tail = tail;
+    --q->len;
+    return q;
+}
+
+
+static pnode *setItem(const axv_allocator *allocator, pnode *n, unsigned level, uint64_t index, void *val,
+                      uint64_t edit) {
+    pnode *m = editable(allocator, n, level, edit);
+    if (!m)
+        return NULL;
+    const unsigned sub = (index >> level) & MASK;
+    if (level == 0) {
+        m->slots[sub] = val;
+        return m;
+    }
+    pnode *child = setItem(allocator, m->slots[sub], level - BITS, index, val, edit);
+    if (!child) {
+        if (m != n)
+            release(allocator, m, level);
+        return NULL;
+    }
+    if (child != m->slots[sub])
+        release(allocator, m->slots[sub], level - BITS);
+    m->slots[sub] = child;
+    return m;
+}
+
+
+axpvector *axpv_set(axpvector *p, int64_t index, void *val) {
+    uint64_t i = normaliseIndex(p->len, index);
+    if (i >= p->len)
+        return NULL;
+    axpvector *q = startVersion(p);
+    if (!q)
+        return NULL;
+    const uint64_t edit = newEdit();
+    const bool inTail = i >= tailOffset(q);
+    pnode **node = inTail ? &q->tail : &q->root;
+    const unsigned shift = inTail ? 0 : q->shift;
+    pnode *n = setItem(q->allocator, *node, shift, inTail ? i - tailOffset(q) : i, val, edit);
+    if (!n) {
+        axpv_destroy(q);
+        return NULL;
+    }
+    if (n != *node)
+        release(q->allocator, *node, shift);
+    *node = n;
+    return q;
+}
+
+
+axpvector *axpv_slice(axpvector *p, int64_t index1, int64_t index2) {
+    int64_t i1 = index1 + (index1 < 0) * (int64_t) p->len;
+    int64_t i2 = index2 + (index2 < 0) * (int64_t) p->len;
+    i1 = i1 < 0 ? 0 : MIN(i1, (int64_t) p->len);
+    i2 = i2 < i1 ? i1 : MIN(i2, (int64_t) p->len);
+    axpvector *q = newVersion(p->allocator);
+    if (!q)
+        return NULL;
+    if (appendRange(q, p, (uint64_t) i1, (uint64_t) i2, newEdit())) {
+        axpv_destroy(q);
+        return NULL;
+    }
+    return q;
+}
+
+
+axpvector *axpv_concat(axpvector *p1, axpvector *p2) {
+    axpvector *q = startVersion(p1);
+    if (!q)
+        return NULL;
+    if (appendRange(q, p2, 0, p2->len, newEdit())) {
+        axpv_destroy(q);
+        return NULL;
+    }
+    return q;
+}
@@ -0,0 +1,117 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVPERSISTENT_H
+#define AXVECTOR_AXVPERSISTENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "axvector.h"
+
+/*
+    axvpersistent provides a persistent vector of void * items. An axpvector is an immutable version: functions
+    that would change it return a new version instead and leave the old one intact, so every version stays readable
+    for as long as it is not destroyed.
+
+    Items are stored in a trie of nodes with 32 slots each, plus a tail node holding the last up to 32 items.
+    Versions share all nodes that the update did not touch, so push, pop and set copy only O(log32 n) nodes. Nodes are
+    reference-counted atomically and never written to once they are part of a version, hence versions sharing nodes
+    may be read and destroyed by different threads. Every version returned must be destroyed with axpv_destroy().
+
+    The trie is not relaxed (it is no RRB tree), so concatenation and slicing append the items one leaf at a time.
+    The left operand of axpv_concat() is shared, the right one is copied, and slices are built anew. For bulk algorithms, a version can be converted to and from a
+    flat axvector.
+
+    The struct is opaque, as its nodes are reference-counted with C11 atomics. Like axvector, axpvector has negative
+    indexing.
+*/
+typedef struct axpvector axpvector;
+
+
+/**
+ * Create an empty persistent vector.
+ * @param allocator Allocator or NULL to use the memory functions set by axv_memoryfn(). Used for all versions
+ * derived from this one.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_new(const axv_allocator *allocator);
+/**
+ * Create a persistent vector holding the items of a flat vector, using the same allocator.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_fromVector(axvector *v);
+/**
+ * Create a flat vector holding the items of a version, using the same allocator.
+ * @return New axvector or NULL if OOM.
+ */
+axvector *axpv_toVector(axpvector *p);
+/**
+ * Get another handle to a version in constant time, e.g. to hand it to another thread. Both handles have to be
+ * destroyed.
+ * @return The same version or NULL if OOM.
+ */
+axpvector *axpv_copy(axpvector *p);
+/**
+ * Destroy a version. Nodes are freed once no version uses them anymore.
+ */
+void axpv_destroy(axpvector *p);
+/**
+ * Number of items in a version.
+ * @return Number of items.
+ */
+uint64_t axpv_len(axpvector *p);
+/**
+ * Index a version and return an item. O(log32 n), constant time for the last 32 items.
+ * @param index May be negative.
+ * @return Item at index or NULL if index out of range.
+ */
+void *axpv_at(axpvector *p, int64_t index);
+/**
+ * Create a version with an item pushed at the end.
+ * @param val Item.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_push(axpvector *p, void *val);
+/**
+ * Create a version with n items pushed at the end.
+ * @param src Array of n items.
+ * @param n Number of items.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_pushN(axpvector *p, void **src, uint64_t n);
+/**
+ * Create a version without the last item. Use axpv_at(p, -1) to get it first.
+ * @return New version, empty if p is empty, or NULL if OOM.
+ */
+axpvector *axpv_pop(axpvector *p);
+/**
+ * Create a version with the item at index replaced.
+ * @param index May be negative.
+ * @param val The new item.
+ * @return New version or NULL if index out of range or OOM.
+ */
+axpvector *axpv_set(axpvector *p, int64_t index, void *val);
+/**
+ * Create a version holding a slice of the items of another one. Takes O(n) in the length of the slice.
+ * @param index1 Beginning of slice. May be negative. Inclusive.
+ * @param index2 End of slice. May be negative. Exclusive.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_slice(axpvector *p, int64_t index1, int64_t index2);
+/**
+ * Create a version holding the items of p1 followed by those of p2. The nodes of p1 are shared, so this takes
+ * O(n) in the length of p2 only.
+ * @return New version or NULL if OOM.
+ */
+axpvector *axpv_concat(axpvector *p1, axpvector *p2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AXVECTOR_AXVPERSISTENT_H
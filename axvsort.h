@@ -0,0 +1,288 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVSORT_H
+#define AXVECTOR_AXVSORT_H
+
+#include <stdint.h>
+
+/*
+    axvsort is the sort engine behind axv_sort() and axv_sortSection(). It is an introsort: quicksort with a
+    median-of-three (ninther for large inputs) pivot, falling back to heapsort once the recursion gets too deep and
+    to insertion sort for short ranges. The sort is not stable.
+
+    The engine is generated by a macro so that the comparison is a plain expression the compiler can inline instead
+    of an indirect call through a function pointer.
+
+    AXV_DEFINE_SORT(name, cmp_expr) defines
+
+        static inline void name(void **items, uint64_t len, void *ctx);
+
+    which sorts items[0..len). cmp_expr is evaluated with the two items to compare bound to the variables a and b,
+    both of type void *, and the ctx argument bound to ctx. Like a standard library comparator it shall yield a
+    negative, zero or positive int. Note that, unlike the comparator of an axvector, a and b are the items themselves
+    and not pointers to them. Example:
+
+        AXV_DEFINE_SORT(sortById, (((struct rec *) a)->id > ((struct rec *) b)->id)
+                                - (((struct rec *) a)->id < ((struct rec *) b)->id))
+        ...
+        sortById(axv_data(v), axv_ulen(v), NULL);
+
+    Alongside, the following functions are defined for use by axv_stableSort(), axv_partialSort() and
+    axv_nthElement():
+
+        static inline void name##Stable_(void **items, uint64_t len, void **scratch, void *ctx);
+        static inline void name##Partial_(void **items, uint64_t len, uint64_t k, void *ctx);
+        static inline void name##Select_(void **items, uint64_t len, uint64_t k, void *ctx);
+
+    name##Stable_ is a stable, adaptive merge sort in the manner of TimSort: it finds runs that are already sorted
+    (reversing strictly descending ones), extends short runs by insertion sort and merges neighbouring runs while
+    keeping their lengths balanced. Partially sorted input thus takes close to linear time. scratch must have room
+    for len / 2 items. name##Select_ is an introselect: afterwards, items[k] is the item that would be there if
+    items were sorted, no item before it compares greater and no item after it compares less. name##Partial_ moves
+    the k least items to the front in sorted order and leaves the rest in unspecified order.
+
+    AXV_DEFINE_SORT_TYPED(name, T, cmp_expr) does the same for an array of any assignable type T, in which case a and
+    b are of type T.
+
+    AXV_COMPARE_ADDRESSES(a, b) is the cmp_expr of the default comparator axv_compareAddress(), comparing two items
+    by their addresses. Code that handles the default comparator separately uses it to avoid the indirect call.
+*/
+
+#ifndef AXV_SORT_INSERTION
+#define AXV_SORT_INSERTION 16
+#endif
+
+#ifndef AXV_SORT_NINTHER
+#define AXV_SORT_NINTHER 128
+#endif
+
+#ifndef AXV_SORT_RUNS
+#define AXV_SORT_RUNS 96
+#endif
+
+#define AXV_COMPARE_ADDRESSES(a, b) (((uintptr_t) (a) > (uintptr_t) (b)) - ((uintptr_t) (a) < (uintptr_t) (b)))
+
+#define AXV_DEFINE_SORT(name, cmp_expr) AXV_DEFINE_SORT_TYPED(name, void *, cmp_expr)
+
+#define AXV_DEFINE_SORT_TYPED(name, T, cmp_expr)                                                                    \
+static inline int name##Cmp_(T a, T b, void *ctx) {                                                                 \
+    (void) ctx;                                                                                                     \
+    return (cmp_expr);                                                                                              \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Swap_(T *x, T *y) {                                                                        \
+    T tmp = *x;                                                                                                     \
+    *x = *y;                                                                                                        \
+    *y = tmp;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Insertion_(T *a, uint64_t n, void *ctx) {                                                  \
+    for (uint64_t i = 1; i < n; ++i) {                                                                              \
+        T x = a[i];                                                                                                 \
+        uint64_t j = i;                                                                                             \
+        for (; j > 0 && name##Cmp_(x, a[j - 1], ctx) < 0; --j)                                                      \
+            a[j] = a[j - 1];                                                                                        \
+        a[j] = x;                                                                                                   \
+    }                                                                                                               \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##SiftDown_(T *a, uint64_t root, uint64_t n, void *ctx) {                                    \
+    T x = a[root];                                                                                                  \
+    for (uint64_t child; (child = 2 * root + 1) < n; root = child) {                                                \
+        if (child + 1 < n && name##Cmp_(a[child], a[child + 1], ctx) < 0)                                           \
+            ++child;                                                                                                \
+        if (name##Cmp_(x, a[child], ctx) >= 0)                                                                      \
+            break;                                                                                                  \
+        a[root] = a[child];                                                                                         \
+    }                                                                                                               \
+    a[root] = x;                                                                                                    \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Heapsort_(T *a, uint64_t n, void *ctx) {                                                   \
+    for (uint64_t i = n / 2; i-- > 0;)                                                                              \
+        name##SiftDown_(a, i, n, ctx);                                                                              \
+    for (uint64_t i = n; i-- > 1;) {                                                                                \
+        name##Swap_(a, a + i);                                                                                      \
+        name##SiftDown_(a, 0, i, ctx);                                                                              \
+    }                                                                                                               \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Sort3_(T *a, uint64_t i, uint64_t j, uint64_t k, void *ctx) {                              \
+    if (name##Cmp_(a[j], a[i], ctx) < 0)                                                                            \
+        name##Swap_(a + i, a + j);                                                                                  \
+    if (name##Cmp_(a[k], a[j], ctx) < 0) {                                                                          \
+        name##Swap_(a + j, a + k);                                                                                  \
+        if (name##Cmp_(a[j], a[i], ctx) < 0)                                                                        \
+            name##Swap_(a + i, a + j);                                                                              \
+    }                                                                                                               \
+}                                                                                                                   \
+                                                                                                                    \
+static inline uint64_t name##Partition_(T *a, uint64_t n, void *ctx) {                                              \
+    const uint64_t m = n / 2;                                                                                       \
+    if (n > AXV_SORT_NINTHER) {                                                                                     \
+        const uint64_t s = n / 8;                                                                                   \
+        name##Sort3_(a, 0, s, 2 * s, ctx);                                                                          \
+        name##Sort3_(a, m - s, m, m + s, ctx);                                                                      \
+        name##Sort3_(a, n - 1 - 2 * s, n - 1 - s, n - 1, ctx);                                                      \
+        name##Sort3_(a, s, m, n - 1 - s, ctx);                                                                      \
+    } else {                                                                                                        \
+        name##Sort3_(a, 0, m, n - 1, ctx);                                                                          \
+    }                                                                                                               \
+    name##Swap_(a, a + m);                                                                                          \
+    T pivot = a[0];                                                                                                 \
+    uint64_t i = 0, j = n;                                                                                          \
+    for (;;) {                                                                                                      \
+        do ++i; while (i < n && name##Cmp_(a[i], pivot, ctx) < 0);                                                  \
+        do --j; while (name##Cmp_(pivot, a[j], ctx) < 0);                                                           \
+        if (i >= j)                                                                                                 \
+            break;                                                                                                  \
+        name##Swap_(a + i, a + j);                                                                                  \
+    }                                                                                                               \
+    name##Swap_(a, a + j);                                                                                          \
+    return j;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Intro_(T *a, uint64_t n, uint64_t depth, void *ctx) {                                      \
+    while (n > AXV_SORT_INSERTION) {                                                                                \
+        if (depth-- == 0) {                                                                                         \
+            name##Heapsort_(a, n, ctx);                                                                             \
+            return;                                                                                                 \
+        }                                                                                                           \
+        const uint64_t p = name##Partition_(a, n, ctx);                                                             \
+        if (p < n - p - 1) {                                                                                        \
+            name##Intro_(a, p, depth, ctx);                                                                         \
+            a += p + 1;                                                                                             \
+            n -= p + 1;                                                                                             \
+        } else {                                                                                                    \
+            name##Intro_(a + p + 1, n - p - 1, depth, ctx);                                                         \
+            n = p;                                                                                                  \
+        }                                                                                                           \
+    }                                                                                                               \
+    name##Insertion_(a, n, ctx);                                                                                    \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name(T *items, uint64_t len, void *ctx) {                                                        \
+    uint64_t depth = 0;                                                                                             \
+    for (uint64_t n = len; n > 1; n >>= 1)                                                                          \
+        depth += 2;                                                                                                 \
+    name##Intro_(items, len, depth, ctx);                                                                           \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Select_(T *a, uint64_t n, uint64_t k, void *ctx) {                                         \
+    uint64_t depth = 0;                                                                                             \
+    for (uint64_t m = n; m > 1; m >>= 1)                                                                            \
+        depth += 2;                                                                                                 \
+    while (n > AXV_SORT_INSERTION) {                                                                                \
+        if (depth-- == 0) {                                                                                         \
+            name##Heapsort_(a, n, ctx);                                                                             \
+            return;                                                                                                 \
+        }                                                                                                           \
+        const uint64_t p = name##Partition_(a, n, ctx);                                                             \
+        if (k == p)                                                                                                 \
+            return;                                                                                                 \
+        if (k < p) {                                                                                                \
+            n = p;                                                                                                  \
+        } else {                                                                                                    \
+            a += p + 1;                                                                                             \
+            n -= p + 1;                                                                                             \
+            k -= p + 1;                                                                                             \
+        }                                                                                                           \
+    }                                                                                                               \
+    name##Insertion_(a, n, ctx);                                                                                    \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Partial_(T *a, uint64_t n, uint64_t k, void *ctx) {                                        \
+    if (k < n) {                                                                                                    \
+        name##Select_(a, n, k, ctx);                                                                                \
+        n = k;                                                                                                      \
+    }                                                                                                               \
+    name(a, n, ctx);                                                                                                \
+}                                                                                                                   \
+                                                                                                                    \
+static inline uint64_t name##Run_(T *a, uint64_t n, void *ctx) {                                                    \
+    if (n < 2)                                                                                                      \
+        return n;                                                                                                   \
+    uint64_t i = 2;                                                                                                 \
+    if (name##Cmp_(a[1], a[0], ctx) < 0) {                                                                          \
+        while (i < n && name##Cmp_(a[i], a[i - 1], ctx) < 0)                                                        \
+            ++i;                                                                                                    \
+        for (uint64_t l = 0, r = i - 1; l < r; ++l, --r)                                                            \
+            name##Swap_(a + l, a + r);                                                                              \
+    } else {                                                                                                        \
+        while (i < n && name##Cmp_(a[i], a[i - 1], ctx) >= 0)                                                       \
+            ++i;                                                                                                    \
+    }                                                                                                               \
+    return i;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Merge_(T *a, uint64_t l, uint64_t n, T *s, void *ctx) {                                    \
+    if (name##Cmp_(a[l], a[l - 1], ctx) >= 0)                                                                       \
+        return;                                                                                                     \
+    if (l <= n - l) {                                                                                               \
+        for (uint64_t i = 0; i < l; ++i)                                                                            \
+            s[i] = a[i];                                                                                            \
+        uint64_t i = 0, j = l, k = 0;                                                                               \
+        while (i < l && j < n)                                                                                      \
+            a[k++] = name##Cmp_(a[j], s[i], ctx) < 0 ? a[j++] : s[i++];                                             \
+        while (i < l)                                                                                               \
+            a[k++] = s[i++];                                                                                        \
+    } else {                                                                                                        \
+        for (uint64_t j = l; j < n; ++j)                                                                            \
+            s[j - l] = a[j];                                                                                        \
+        uint64_t i = l, j = n - l, k = n;                                                                           \
+        while (i > 0 && j > 0)                                                                                      \
+            a[--k] = name##Cmp_(s[j - 1], a[i - 1], ctx) < 0 ? a[--i] : s[--j];                                     \
+        while (j > 0)                                                                                               \
+            a[--k] = s[--j];                                                                                        \
+    }                                                                                                               \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##MergeAt_(T *a, uint64_t *base, uint64_t *run, uint64_t *runs, uint64_t i, T *s,            \
+                                  void *ctx) {                                                                      \
+    name##Merge_(a + base[i], run[i], run[i] + run[i + 1], s, ctx);                                                 \
+    run[i] += run[i + 1];                                                                                           \
+    for (uint64_t j = i + 1; j + 1 < *runs; ++j) {                                                                  \
+        base[j] = base[j + 1];                                                                                      \
+        run[j] = run[j + 1];                                                                                        \
+    }                                                                                                               \
+    --*runs;                                                                                                        \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##Stable_(T *a, uint64_t n, T *s, void *ctx) {                                               \
+    uint64_t base[AXV_SORT_RUNS], run[AXV_SORT_RUNS], runs = 0, minRun = n, odd = 0;                                \
+    for (; minRun >= 2 * AXV_SORT_INSERTION; minRun >>= 1)                                                          \
+        odd |= minRun & 1;                                                                                          \
+    minRun += odd;                                                                                                  \
+    for (uint64_t lo = 0; lo < n;) {                                                                                \
+        uint64_t len = name##Run_(a + lo, n - lo, ctx);                                                             \
+        if (len < minRun) {                                                                                         \
+            len = minRun < n - lo ? minRun : n - lo;                                                                \
+            name##Insertion_(a + lo, len, ctx);                                                                     \
+        }                                                                                                           \
+        base[runs] = lo;                                                                                            \
+        run[runs++] = len;                                                                                          \
+        lo += len;                                                                                                  \
+        while (runs > 1) {                                                                                          \
+            uint64_t i = runs - 2;                                                                                  \
+            if ((i > 0 && run[i - 1] <= run[i] + run[i + 1]) || (i > 1 && run[i - 2] <= run[i - 1] + run[i])) {     \
+                if (run[i - 1] < run[i + 1])                                                                        \
+                    --i;                                                                                            \
+            } else if (run[i] > run[i + 1]) {                                                                       \
+                break;                                                                                              \
+            }                                                                                                       \
+            name##MergeAt_(a, base, run, &runs, i, s, ctx);                                                         \
+        }                                                                                                           \
+    }                                                                                                               \
+    while (runs > 1) {                                                                                              \
+        uint64_t i = runs - 2;                                                                                      \
+        if (i > 0 && run[i - 1] < run[i + 1])                                                                       \
+            --i;                                                                                                    \
+        name##MergeAt_(a, base, run, &runs, i, s, ctx);                                                             \
+    }                                                                                                               \
+}
+
+#endif //AXVECTOR_AXVSORT_H
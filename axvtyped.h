@@ -0,0 +1,296 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXVECTOR_AXVTYPED_H
+#define AXVECTOR_AXVTYPED_H
+
+#include "axvector.h"
+#include "axvsort.h"
+#include <string.h>
+
+/*
+    axvtyped generates value-typed vectors. Instead of void * items, a typed vector stores values of some type T
+    contiguously, so integers and small structs need neither casts nor boxing.
+
+    AXV_DECLARE(name, T, cmp_expr) defines the struct type name and the functions name_new(), name_push() etc., which
+    mirror their axvector counterparts. The comparator is given as an expression cmp_expr of the two values a and b of
+    type T, yielding a negative, zero or positive int like a standard library comparator. It is inlined into
+    name_sort() and name_binarySearch(). Example:
+
+        AXV_DECLARE(intvec, int, (a > b) - (a < b))
+        ...
+        intvec *v = intvec_new();
+        intvec_push(v, 42);
+        int *last = intvec_at(v, -1);
+
+    Differences to axvector:
+    - Functions indexing the vector (at, get, top) return a pointer to the value in the vector, or NULL if the index
+      is out of range. The pointer is valid until the vector is resized.
+    - pop returns the removed value, or a zero-initialised T if the vector is empty.
+    - There is no destructor, context, growth policy or default comparator. Vectors grow geometrically.
+    - Predicates take a pointer to the value. All functions are static inline, so when a predicate is a known
+      function at the call site, an optimising compiler inlines it into the loop as well.
+
+    To have a predicate inlined regardless of the call site, give it as an expression like the comparator.
+    AXV_DECLARE_PREDICATE(name, pred, pred_expr), used after AXV_DECLARE(name, ...), defines name_filterPred(),
+    name_anyPred(), name_allPred() and name_countPred() for pred being Pred. pred_expr is evaluated with the value to
+    test bound to the variable x of type const T and yields true or false. Example:
+
+        AXV_DECLARE_PREDICATE(intvec, Even, x % 2 == 0)
+        ...
+        intvec_filterEven(v);
+
+    Memory is obtained from an axv_allocator, by default the one also used by axvector.
+
+    As with axvector, the struct definition is given for optimisation purposes only.
+*/
+
+#define AXV_DECLARE(name, T, cmp_expr)                                                                              \
+typedef struct name {                                                                                               \
+    T *items;                                                                                                       \
+    uint64_t len;                                                                                                   \
+    uint64_t cap;                                                                                                   \
+    const axv_allocator *allocator;                                                                                 \
+} name;                                                                                                             \
+typedef T name##Item_;                                                                                              \
+                                                                                                                    \
+AXV_DEFINE_SORT_TYPED(name##Engine_, T, cmp_expr)                                                                   \
+                                                                                                                    \
+static inline bool name##_initWithAllocator(name *v, uint64_t size, const axv_allocator *allocator) {               \
+    v->allocator = allocator ? allocator : axv_defaultAllocator();                                                  \
+    v->cap = size ? size : 1;                                                                                       \
+    v->len = 0;                                                                                                     \
+    v->items = (T *) v->allocator->alloc(v->cap * sizeof(T), v->allocator->ctx);                                    \
+    return !v->items;                                                                                               \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_init(name *v, uint64_t size) {                                                            \
+    return name##_initWithAllocator(v, size, NULL);                                                                 \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##_deinit(name *v) {                                                                         \
+    v->allocator->free(v->items, v->cap * sizeof(T), v->allocator->ctx);                                            \
+    v->items = NULL;                                                                                                \
+    v->len = v->cap = 0;                                                                                            \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_newWithAllocator(uint64_t size, const axv_allocator *allocator) {                        \
+    allocator = allocator ? allocator : axv_defaultAllocator();                                                     \
+    name *v = (name *) allocator->alloc(sizeof *v, allocator->ctx);                                                 \
+    if (v && name##_initWithAllocator(v, size, allocator)) {                                                        \
+        allocator->free(v, sizeof *v, allocator->ctx);                                                              \
+        return NULL;                                                                                                \
+    }                                                                                                               \
+    return v;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_newSized(uint64_t size) {                                                                \
+    return name##_newWithAllocator(size, NULL);                                                                     \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_new(void) {                                                                              \
+    return name##_newSized(7);                                                                                      \
+}                                                                                                                   \
+                                                                                                                    \
+static inline void name##_destroy(name *v) {                                                                        \
+    const axv_allocator *allocator = v->allocator;                                                                  \
+    name##_deinit(v);                                                                                               \
+    allocator->free(v, sizeof *v, allocator->ctx);                                                                  \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_resize(name *v, uint64_t size) {                                                          \
+    size = size ? size : 1;                                                                                         \
+    T *items = (T *) v->allocator->realloc(v->items, v->cap * sizeof(T), size * sizeof(T), v->allocator->ctx);      \
+    if (!items)                                                                                                     \
+        return true;                                                                                                \
+    v->items = items;                                                                                               \
+    v->cap = size;                                                                                                  \
+    v->len = v->len < size ? v->len : size;                                                                         \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_reserve(name *v, uint64_t n) {                                                            \
+    if (n <= v->cap)                                                                                                \
+        return false;                                                                                               \
+    uint64_t size = (v->cap << 1) | 1;                                                                              \
+    return name##_resize(v, size > n ? size : n);                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_push(name *v, T val) {                                                                    \
+    if (v->len >= v->cap && name##_reserve(v, v->len + 1))                                                          \
+        return true;                                                                                                \
+    v->items[v->len++] = val;                                                                                       \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline T name##_pop(name *v) {                                                                               \
+    T val;                                                                                                          \
+    if (v->len)                                                                                                     \
+        return v->items[--v->len];                                                                                  \
+    memset(&val, 0, sizeof val);                                                                                    \
+    return val;                                                                                                     \
+}                                                                                                                   \
+                                                                                                                    \
+static inline T *name##_top(name *v) {                                                                              \
+    return v->len ? v->items + v->len - 1 : NULL;                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline int64_t name##_len(name *v) {                                                                         \
+    return (int64_t) v->len;                                                                                        \
+}                                                                                                                   \
+                                                                                                                    \
+static inline uint64_t name##_ulen(name *v) {                                                                       \
+    return v->len;                                                                                                  \
+}                                                                                                                   \
+                                                                                                                    \
+static inline uint64_t name##_ucap(name *v) {                                                                       \
+    return v->cap;                                                                                                  \
+}                                                                                                                   \
+                                                                                                                    \
+static inline T *name##_data(name *v) {                                                                             \
+    return v->items;                                                                                                \
+}                                                                                                                   \
+                                                                                                                    \
+static inline T *name##_at(name *v, int64_t index) {                                                                \
+    uint64_t i = index + (index < 0) * v->len;                                                                      \
+    return i < v->len ? v->items + i : NULL;                                                                        \
+}                                                                                                                   \
+                                                                                                                    \
+static inline T *name##_get(name *v, uint64_t index) {                                                              \
+    return index < v->len ? v->items + index : NULL;                                                                \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_set(name *v, int64_t index, T val) {                                                      \
+    uint64_t i = index + (index < 0) * v->len;                                                                      \
+    if (i >= v->len)                                                                                                \
+        return true;                                                                                                \
+    v->items[i] = val;                                                                                              \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_clear(name *v) {                                                                         \
+    v->len = 0;                                                                                                     \
+    return v;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_shift(name *v, int64_t index, int64_t n) {                                                \
+    uint64_t i = index + (index < 0) * v->len;                                                                      \
+    if (i > v->len)                                                                                                 \
+        return true;                                                                                                \
+    if (n > 0) {                                                                                                    \
+        if (name##_reserve(v, v->len + n))                                                                          \
+            return true;                                                                                            \
+        memmove(v->items + i + n, v->items + i, (v->len - i) * sizeof(T));                                          \
+        memset((void *) (v->items + i), 0, n * sizeof(T));                                                          \
+        v->len += n;                                                                                                \
+    } else if (n < 0) {                                                                                             \
+        uint64_t m = (uint64_t) -n < v->len - i ? (uint64_t) -n : v->len - i;                                       \
+        memmove(v->items + i, v->items + i + m, (v->len - i - m) * sizeof(T));                                      \
+        v->len -= m;                                                                                                \
+    }                                                                                                               \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_slice(name *v, int64_t index1, int64_t index2) {                                         \
+    int64_t len = (int64_t) v->len;                                                                                 \
+    int64_t i1 = index1 + (index1 < 0) * len;                                                                       \
+    int64_t i2 = index2 + (index2 < 0) * len;                                                                       \
+    i1 = i1 < 0 ? 0 : i1 > len ? len : i1;                                                                          \
+    i2 = i2 < i1 ? i1 : i2 > len ? len : i2;                                                                        \
+    name *v2 = name##_newWithAllocator((uint64_t) (i2 - i1), v->allocator);                                         \
+    if (!v2)                                                                                                        \
+        return NULL;                                                                                                \
+    memcpy(v2->items, v->items + i1, (uint64_t) (i2 - i1) * sizeof(T));                                             \
+    v2->len = (uint64_t) (i2 - i1);                                                                                 \
+    return v2;                                                                                                      \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_filter(name *v, bool (*f)(const T *, void *), void *arg) {                               \
+    uint64_t len = 0;                                                                                               \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        if (f(v->items + i, arg))                                                                                   \
+            v->items[len++] = v->items[i];                                                                          \
+    }                                                                                                               \
+    v->len = len;                                                                                                   \
+    return v;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_any(name *v, bool (*f)(const T *, void *), void *arg) {                                   \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        if (f(v->items + i, arg))                                                                                   \
+            return true;                                                                                            \
+    }                                                                                                               \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline name *name##_sort(name *v) {                                                                          \
+    name##Engine_(v->items, v->len, NULL);                                                                          \
+    return v;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline int64_t name##_binarySearch(name *v, T val) {                                                         \
+    uint64_t lo = 0, hi = v->len;                                                                                   \
+    while (lo < hi) {                                                                                               \
+        uint64_t mid = lo + (hi - lo) / 2;                                                                          \
+        int c = name##Engine_Cmp_(v->items[mid], val, NULL);                                                        \
+        if (c == 0)                                                                                                 \
+            return (int64_t) mid;                                                                                   \
+        if (c < 0)                                                                                                  \
+            lo = mid + 1;                                                                                           \
+        else                                                                                                        \
+            hi = mid;                                                                                               \
+    }                                                                                                               \
+    return -1;                                                                                                      \
+}                                                                                                                   \
+                                                                                                                    \
+static inline int64_t name##_linearSearch(name *v, T val) {                                                         \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        if (name##Engine_Cmp_(val, v->items[i], NULL) == 0)                                                         \
+            return (int64_t) i;                                                                                     \
+    }                                                                                                               \
+    return -1;                                                                                                      \
+}
+
+#define AXV_DECLARE_PREDICATE(name, pred, pred_expr)                                                                \
+static inline name *name##_filter##pred(name *v) {                                                                  \
+    uint64_t len = 0;                                                                                               \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        const name##Item_ x = v->items[i];                                                                          \
+        if (pred_expr)                                                                                              \
+            v->items[len++] = x;                                                                                    \
+    }                                                                                                               \
+    v->len = len;                                                                                                   \
+    return v;                                                                                                       \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_any##pred(name *v) {                                                                      \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        const name##Item_ x = v->items[i];                                                                          \
+        if (pred_expr)                                                                                              \
+            return true;                                                                                            \
+    }                                                                                                               \
+    return false;                                                                                                   \
+}                                                                                                                   \
+                                                                                                                    \
+static inline bool name##_all##pred(name *v) {                                                                      \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        const name##Item_ x = v->items[i];                                                                          \
+        if (!(pred_expr))                                                                                           \
+            return false;                                                                                           \
+    }                                                                                                               \
+    return true;                                                                                                    \
+}                                                                                                                   \
+                                                                                                                    \
+static inline uint64_t name##_count##pred(name *v) {                                                                \
+    uint64_t n = 0;                                                                                                 \
+    for (uint64_t i = 0; i < v->len; ++i) {                                                                         \
+        const name##Item_ x = v->items[i];                                                                          \
+        n += (pred_expr) != 0;                                                                                      \
+    }                                                                                                               \
+    return n;                                                                                                       \
+}
+
+#endif //AXVECTOR_AXVTYPED_H
@@ -0,0 +1,353 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+/*
+    axvbench measures the hot paths of axvector. It is the axvbench target of the CMake build, so build and run it
+    from the repository root with
+
+        cmake -S . -B build && cmake --build build --target axvbench
+        build/axvbench [max size] [benchmark name prefix]
+
+    Sizes run through the powers of ten from 10 up to the max size, 10^6 by default and at most 10^8. ctest runs every
+    benchmark once with a max size of 10 to check that none of them crashes. Every result is printed as one JSON object
+    per line:
+
+        {"bench": "sort", "cmp": "custom", "n": 1000, "ops": 64, "ns_per_op": 51234.5, "allocs_per_op": 0.00,
+         "bytes_moved_per_op": 0.0}
+
+    ns_per_op is the wall-clock time per operation, allocs_per_op counts calls to alloc and realloc of the vector's
+    allocator and bytes_moved_per_op is the number of bytes of item storage read or written to relocate items, i.e.
+    copied by realloc plus moved by the operation itself, according to the model given with each benchmark below.
+    cmp is "default" for the default comparator and "custom" for a comparator called through v->cmp. Setup such as
+    filling or shuffling a vector is not timed. Every benchmark is repeated until it has run for at least 0.1 s.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "axvector.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_TIME_NS 100000000.0
+#define BATCH 64
+
+
+static struct {
+    uint64_t allocs;
+    uint64_t copied;
+} counters;
+
+
+static void *countingAlloc(size_t size, void *ctx) {
+    (void) ctx;
+    ++counters.allocs;
+    return malloc(size);
+}
+
+
+static void *countingRealloc(void *ptr, size_t oldSize, size_t size, void *ctx) {
+    (void) ctx;
+    ++counters.allocs;
+    counters.copied += oldSize < size ? oldSize : size;
+    return realloc(ptr, size);
+}
+
+
+static void countingFree(void *ptr, size_t size, void *ctx) {
+    (void) size;
+    (void) ctx;
+    free(ptr);
+}
+
+
+static const axv_allocator allocator = {countingAlloc, countingRealloc, countingFree, NULL};
+
+
+static int customComparator(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t) *(void *const *) a;
+    uintptr_t y = (uintptr_t) *(void *const *) b;
+    return (x > y) - (x < y);
+}
+
+
+static uint64_t rngState = 0x9e3779b97f4a7c15;
+
+
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static axvector *filled(uint64_t n, bool custom) {
+    axvector *v = axv_newWithAllocator(n, &allocator);
+    if (!v) {
+        fputs("axvbench: out of memory\n", stderr);
+        exit(1);
+    }
+    if (custom)
+        axv_setComparator(v, customComparator);
+    for (uint64_t i = 0; i < n; ++i)
+        axv_push(v, (void *) (uintptr_t) (rng() | 1));
+    return v;
+}
+
+
+/*
+    A benchmark runs one repetition: it sets up, then times ops operations between calls to start() and stop(), and
+    returns the number of bytes it moved by its own model. Counters are only taken between start() and stop().
+*/
+typedef struct run {
+    double elapsed;
+    uint64_t ops;
+    uint64_t allocs;
+    uint64_t copied;
+    double begin;
+} run;
+
+
+static void start(run *r) {
+    counters.allocs = 0;
+    counters.copied = 0;
+    r->begin = now();
+}
+
+
+static void stop(run *r, uint64_t ops) {
+    r->elapsed += now() - r->begin;
+    r->ops += ops;
+    r->allocs += counters.allocs;
+    r->copied += counters.copied;
+}
+
+
+typedef uint64_t (*benchfn)(run *r, uint64_t n, bool custom);
+
+
+// op: one axv_push() onto a vector growing from capacity 1 to n. Moved: realloc only.
+static uint64_t benchPush(run *r, uint64_t n, bool custom) {
+    (void) custom;
+    axvector *v = axv_newWithAllocator(1, &allocator);
+    start(r);
+    for (uint64_t i = 0; i < n; ++i)
+        axv_push(v, (void *) (uintptr_t) i);
+    stop(r, n);
+    axv_destroy(v);
+    return 0;
+}
+
+
+// op: one axv_concat() of BATCH items onto a vector growing to n. Moved: the appended items plus realloc.
+static uint64_t benchConcat(run *r, uint64_t n, bool custom) {
+    axvector *src = filled(BATCH, custom);
+    axvector *v = axv_newWithAllocator(1, &allocator);
+    const uint64_t ops = (n + BATCH - 1) / BATCH;
+    start(r);
+    for (uint64_t i = 0; i < ops; ++i)
+        axv_concat(v, src);
+    stop(r, ops);
+    axv_destroy(v);
+    axv_destroy(src);
+    return ops * BATCH * sizeof(void *);
+}
+
+
+// op: refill a vector of BATCH items, then axv_extend() it onto a vector growing to n. Moved: as axv_concat().
+static uint64_t benchExtend(run *r, uint64_t n, bool custom) {
+    void *batch[BATCH] = {0};
+    axvector *src = filled(BATCH, custom);
+    axvector *v = axv_newWithAllocator(1, &allocator);
+    const uint64_t ops = (n + BATCH - 1) / BATCH;
+    start(r);
+    for (uint64_t i = 0; i < ops; ++i) {
+        axv_pushN(src, batch, BATCH);
+        axv_extend(v, src);
+    }
+    stop(r, ops);
+    axv_destroy(v);
+    axv_destroy(src);
+    return 2 * ops * BATCH * sizeof(void *);
+}
+
+
+/*
+    op: insert one gap with axv_shift(v, i, 1), then close it with axv_shift(v, i, -1), on a vector of n items.
+    Moved: the items behind i, twice, except that removal at the front takes constant time.
+*/
+static uint64_t shiftAt(run *r, uint64_t n, bool custom, uint64_t i) {
+    axvector *v = filled(n, custom);
+    axv_reserve(v, n + 1);
+    const uint64_t ops = n <= 10000 ? 1000 : n < 10000000 ? 10000000 / n : 1;
+    start(r);
+    for (uint64_t k = 0; k < ops; ++k) {
+        axv_shift(v, (int64_t) i, 1);
+        axv_shift(v, (int64_t) i, -1);
+    }
+    stop(r, ops);
+    axv_destroy(v);
+    return ops * (n - i) * sizeof(void *) * (i == 0 ? 1 : 2);
+}
+
+
+static uint64_t benchShiftFront(run *r, uint64_t n, bool custom) {
+    return shiftAt(r, n, custom, 0);
+}
+
+
+static uint64_t benchShiftMiddle(run *r, uint64_t n, bool custom) {
+    return shiftAt(r, n, custom, n / 2);
+}
+
+
+static uint64_t benchShiftBack(run *r, uint64_t n, bool custom) {
+    return shiftAt(r, n, custom, n);
+}
+
+
+// op: one axv_sort() of n random items. Moved: nothing is counted, the sort works in place.
+static uint64_t benchSort(run *r, uint64_t n, bool custom) {
+    axvector *v = filled(n, custom);
+    start(r);
+    axv_sort(v);
+    stop(r, 1);
+    axv_destroy(v);
+    return 0;
+}
+
+
+// op: one axv_binarySearch() for a random present item in a sorted vector of n items. Moved: nothing.
+static uint64_t benchBinarySearch(run *r, uint64_t n, bool custom) {
+    axvector *v = filled(n, custom);
+    axv_sort(v);
+    const uint64_t ops = 100000;
+    void **keys = malloc(ops * sizeof *keys);
+    for (uint64_t i = 0; i < ops; ++i)
+        keys[i] = axv_get(v, rng() % n);
+    int64_t sink = 0;
+    start(r);
+    for (uint64_t i = 0; i < ops; ++i)
+        sink += axv_binarySearch(v, keys[i]);
+    stop(r, ops);
+    if (sink < 0)
+        fputs("axvbench: item not found\n", stderr);
+    free(keys);
+    axv_destroy(v);
+    return 0;
+}
+
+
+static bool keepHalf(const void *item, void *arg) {
+    (void) arg;
+    return (uintptr_t) item & 2;
+}
+
+
+// op: one axv_filter() keeping about half of n items. Moved: every kept item.
+static uint64_t benchFilter(run *r, uint64_t n, bool custom) {
+    axvector *v = filled(n, custom);
+    start(r);
+    axv_filter(v, keepHalf, NULL);
+    stop(r, 1);
+    uint64_t moved = axv_ulen(v) * sizeof(void *);
+    axv_destroy(v);
+    return moved;
+}
+
+
+// op: one axv_partition() of n items into two halves. Moved: every item.
+static uint64_t benchPartition(run *r, uint64_t n, bool custom) {
+    axvector *v = filled(n, custom);
+    start(r);
+    axvector *rejected = axv_partition(v, keepHalf, NULL);
+    stop(r, 1);
+    axv_destroy(rejected);
+    axv_destroy(v);
+    return n * sizeof(void *);
+}
+
+
+// op: one axv_rotate() of n items by n / 3 places. Moved: n + n / 3 items, by block swaps or through the buffer.
+static uint64_t benchRotate(run *r, uint64_t n, bool custom) {
+    axvector *v = filled(n, custom);
+    start(r);
+    axv_rotate(v, (int64_t) (n / 3));
+    stop(r, 1);
+    axv_destroy(v);
+    return (n + n / 3) * sizeof(void *);
+}
+
+
+// op: one axv_clear() of n heap-allocated items with free() as destructor. Moved: nothing.
+static uint64_t benchClear(run *r, uint64_t n, bool custom) {
+    axvector *v = axv_newWithAllocator(n, &allocator);
+    if (custom)
+        axv_setComparator(v, customComparator);
+    axv_setDestructor(v, free);
+    for (uint64_t i = 0; i < n; ++i)
+        axv_push(v, malloc(16));
+    start(r);
+    axv_clear(v);
+    stop(r, 1);
+    axv_destroy(v);
+    return 0;
+}
+
+
+static const struct {
+    const char *name;
+    benchfn fn;
+    bool usesComparator;
+} benchmarks[] = {
+    {"push", benchPush, false},
+    {"concat", benchConcat, false},
+    {"extend", benchExtend, false},
+    {"shift_front", benchShiftFront, false},
+    {"shift_middle", benchShiftMiddle, false},
+    {"shift_back", benchShiftBack, false},
+    {"sort", benchSort, true},
+    {"binary_search", benchBinarySearch, true},
+    {"filter", benchFilter, false},
+    {"partition", benchPartition, false},
+    {"rotate", benchRotate, false},
+    {"clear_destroy", benchClear, false},
+};
+
+
+int main(int argc, char **argv) {
+    uint64_t maxSize = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    const char *prefix = argc > 2 ? argv[2] : "";
+    if (maxSize > 100000000)
+        maxSize = 100000000;
+    for (size_t b = 0; b < sizeof benchmarks / sizeof *benchmarks; ++b) {
+        if (strncmp(benchmarks[b].name, prefix, strlen(prefix)) != 0)
+            continue;
+        for (int custom = 0; custom <= (int) benchmarks[b].usesComparator; ++custom) {
+            for (uint64_t n = 10; n <= maxSize; n *= 10) {
+                run r = {0};
+                uint64_t moved = 0;
+                while (r.elapsed < MIN_TIME_NS)
+                    moved += benchmarks[b].fn(&r, n, custom);
+                printf("{\"bench\": \"%s\", \"cmp\": \"%s\", \"n\": %llu, \"ops\": %llu, \"ns_per_op\": %.1f, "
+                       "\"allocs_per_op\": %.2f, \"bytes_moved_per_op\": %.1f}\n",
+                       benchmarks[b].name, custom ? "custom" : "default", (unsigned long long) n,
+                       (unsigned long long) r.ops, r.elapsed / r.ops, (double) r.allocs / r.ops,
+                       (double) (moved + r.copied) / r.ops);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,2788 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+/*
+    axvtest checks the behaviour of axvector and its modules against plain loops over arrays. It is the axvtest target
+    of the CMake build and is run by ctest:
+
+        cmake -S . -B build && cmake --build build && ctest --test-dir build --output-on-failure
+
+    Every failed check is reported with its file and line, and the exit status is non-zero if any check failed.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "axvconcurrent.h"
+#include "axvector.h"
+#include "axvio.h"
+#include "axvparallel.h"
+#include "axvpersistent.h"
+#include "axvtyped.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+// the defaults of the library's compile-time options, unless the test is built with others
+#ifndef AXV_INLINE_CAP
+#define AXV_INLINE_CAP 8
+#endif
+#ifndef AXV_BATCH
+#define AXV_BATCH 256
+#endif
+#ifndef AXV_MMAP_THRESHOLD
+#define AXV_MMAP_THRESHOLD (64 << 20)
+#endif
+
+
+static int failures = 0;
+
+
+static void check(bool ok, const char *expr, const char *file, int line) {
+    if (!ok) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        ++failures;
+    }
+}
+
+
+static uint64_t rngState = 0x9e3779b97f4a7c15;
+
+
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+
+static void *item(uint64_t x) {
+    return (void *) (uintptr_t) x;
+}
+
+
+static axvector *randomVector(uint64_t n, uint64_t range) {
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < n; ++i)
+        axv_push(v, item(rng() % range + 1));
+    return v;
+}
+
+
+// true iff the items of v are exactly the n items at ref
+static bool equals(axvector *v, void **ref, uint64_t n) {
+    return axv_ulen(v) == n && (n == 0 || memcmp(axv_data(v), ref, n * sizeof(void *)) == 0);
+}
+
+
+static bool ordered(axvector *v) {
+    int (*cmp)(const void *, const void *) = axv_getComparator(v);
+    for (uint64_t i = 1; i < axv_ulen(v); ++i) {
+        if (cmp(axv_data(v) + i - 1, axv_data(v) + i) > 0)
+            return false;
+    }
+    return true;
+}
+
+
+static int compareHigh(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t) *(void *const *) a >> 16;
+    uintptr_t y = (uintptr_t) *(void *const *) b >> 16;
+    return (x > y) - (x < y);
+}
+
+
+static int compareDescending(const void *a, const void *b) {
+    return -axv_compareAddress(a, b);
+}
+
+
+static void testSort(void) {
+    int (*const comparators[])(const void *, const void *) = {NULL, compareDescending, compareHigh};
+    for (int c = 0; c < 3; ++c) {
+        // n up to some thousand items with few or many duplicates, exceeding the insertion sort cutoff and forcing
+        // the partitioning to handle equal keys
+        for (uint64_t n = 0; n < 5000; n = n * 3 + 1) {
+            axvector *v = randomVector(n, c == 2 ? UINT64_C(1) << 24 : n / 2 + 1);
+            axv_setComparator(v, comparators[c]);
+            axvector *ref = axv_copy(v);
+            qsort(axv_data(ref), n, sizeof(void *), axv_getComparator(ref));
+            CHECK(axv_sort(v) == v && ordered(v));
+            if (c < 2)
+                CHECK(equals(v, axv_data(ref), n));
+            axv_destroy(ref);
+            axv_destroy(v);
+        }
+    }
+    // already sorted, descending and all equal inputs are the classic quicksort worst cases
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < 10000; ++i)
+        axv_push(v, item(i % 3 == 0 ? 7 : 10000 - i));
+    CHECK(axv_sort(v) == v && ordered(v) && axv_sort(v) == v && ordered(v));
+    axv_reverse(v);
+    CHECK(axv_sort(v) == v && ordered(v));
+    axv_destroy(v);
+
+    v = randomVector(1000, 100);
+    axvector *ref = axv_copy(v);
+    qsort(axv_data(ref) + 100, 800, sizeof(void *), axv_compareAddress);
+    CHECK(axv_sortSection(v, 100, -100) == v && equals(v, axv_data(ref), 1000));
+    axv_destroy(ref);
+    axv_destroy(v);
+}
+
+
+typedef struct record {
+    uint64_t key;
+    double real;
+    uint64_t pos;
+} record;
+
+
+static uint64_t keyCalls;
+
+
+static uint64_t recordKey(const void *r) {
+    ++keyCalls;
+    return ((const record *) r)->key;
+}
+
+
+static double recordReal(const void *r) {
+    ++keyCalls;
+    return ((const record *) r)->real;
+}
+
+
+// the order the radix sorts must produce: by key, then by original position, as they are stable
+static int compareRecordKeys(const void *a, const void *b) {
+    const record *x = *(record *const *) a, *y = *(record *const *) b;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+
+static int realRank(double x) {
+    return isnan(x) ? (signbit(x) ? -1 : 1) : 0;
+}
+
+
+static int compareRecordReals(const void *a, const void *b) {
+    const record *x = *(record *const *) a, *y = *(record *const *) b;
+    if (realRank(x->real) != realRank(y->real))
+        return realRank(x->real) - realRank(y->real);
+    if (!isnan(x->real) && x->real != y->real)
+        return x->real < y->real ? -1 : 1;
+    if (!isnan(x->real) && signbit(x->real) != signbit(y->real))
+        return signbit(x->real) ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+
+static void testRadixSort(void) {
+    enum { N = 3000 };
+    static record records[N];
+    const double specials[] = {0.0, -0.0, 1.0, -1.0, INFINITY, -INFINITY, NAN, -NAN, 5e-324, -5e-324, 1e308, -2.5};
+    // full keys, few distinct keys, keys differing only in their top byte (most digits skipped) and equal keys
+    for (int pattern = 0; pattern < 4; ++pattern) {
+        for (uint64_t n = 0; n <= N; n = n ? n * 4 : 1) {
+            axvector *v = axv_new();
+            for (uint64_t i = 0; i < n; ++i) {
+                const uint64_t r = rng();
+                records[i].key = pattern == 0 ? r : pattern == 1 ? r % 5 : pattern == 2 ? r << 56 : 42;
+                records[i].real = r % 3 ? (double) (int64_t) r / 1e9 : specials[r % 12];
+                records[i].pos = i;
+                axv_push(v, records + i);
+            }
+            axvector *ref = axv_copy(v);
+            qsort(axv_data(ref), n, sizeof(void *), compareRecordKeys);
+            keyCalls = 0;
+            CHECK(!axv_sortByKey(v, recordKey) && equals(v, axv_data(ref), n));
+            CHECK(keyCalls == (n < 2 ? 0 : n));
+
+            for (uint64_t i = 0; i < n; ++i)
+                ((record *) axv_get(v, i))->pos = i;
+            qsort(axv_data(ref), n, sizeof(void *), compareRecordReals);
+            keyCalls = 0;
+            CHECK(!axv_sortByFloatKey(v, recordReal) && equals(v, axv_data(ref), n));
+            CHECK(keyCalls == (n < 2 ? 0 : n));
+            axv_destroy(ref);
+            axv_destroy(v);
+        }
+    }
+}
+
+
+static void *addOne(void *x, void *arg) {
+    (void) arg;
+    return item((uintptr_t) x + 1);
+}
+
+
+static bool isEven(const void *x, void *arg) {
+    (void) arg;
+    return (uintptr_t) x % 2 == 0;
+}
+
+
+static bool isMultipleOf10(const void *x, void *arg) {
+    (void) arg;
+    return (uintptr_t) x % 10 == 0;
+}
+
+
+static bool isZero(const void *x, void *arg) {
+    (void) arg;
+    return x == NULL;
+}
+
+
+static _Atomic uint64_t destroyed;
+
+
+static void countDestroyed(void *x) {
+    (void) x;
+    ++destroyed;
+}
+
+
+// runs the tasks on the calling thread, last one first, to show that results do not depend on the order of tasks
+static void runBackwards(axv_task task, void *arg, uint64_t n, void *ctx) {
+    (void) ctx;
+    for (uint64_t i = n; i > 0; --i)
+        task(arg, i - 1);
+}
+
+
+static void checkParallel(uint64_t n) {
+    for (int custom = 0; custom < 3; ++custom) {
+        axvector *v = randomVector(n, custom == 2 ? 1000 : UINT64_C(1) << 40);
+        axv_setComparator(v, custom == 1 ? compareDescending : custom == 2 ? compareHigh : NULL);
+        axvector *ref = axv_copy(v);
+        void *probe = axv_get(v, n / 3);
+
+        CHECK(axv_pcount(v, probe) == axv_count(ref, probe));
+        CHECK(axv_pmax(v) == axv_max(ref) && axv_pmin(v) == axv_min(ref));
+        CHECK(axv_pany(v, isEven, NULL) == axv_any(ref, isEven, NULL) && !axv_pany(v, isZero, NULL));
+        CHECK(axv_pall(v, isEven, NULL) == axv_all(ref, isEven, NULL) && axv_pall(v, isZero, NULL) == (n == 0));
+
+        CHECK(axv_pmap(v, addOne, NULL) == v && axv_map(ref, addOne, NULL) == ref);
+        CHECK(equals(v, axv_data(ref), n));
+        axv_setDestructor(v, countDestroyed);
+        destroyed = 0;
+        CHECK(axv_pfilter(v, isEven, NULL) == v && axv_filter(ref, isEven, NULL) == ref);
+        CHECK(equals(v, axv_data(ref), axv_ulen(ref)) && destroyed == n - axv_ulen(ref));
+        axv_setDestructor(v, NULL);
+
+        // with a hash index and a snapshot, which psort must neither corrupt nor race on
+        axv_setHash(v, custom == 2 ? NULL : axv_hashAddress);
+        CHECK(axv_linearSearch(v, probe) == axv_linearSearch(ref, probe));
+        axvector *s = axv_snapshot(v);
+        CHECK(axv_psort(v) == v && ordered(v) && equals(s, axv_data(ref), axv_ulen(ref)));
+        CHECK(axv_sort(ref) == ref && (custom == 2 || equals(v, axv_data(ref), axv_ulen(ref))));
+        for (uint64_t k = 0; k < 10 && axv_ulen(v); ++k) {
+            void *x = axv_get(ref, rng() % axv_ulen(ref)), *found = axv_at(v, axv_linearSearch(v, x));
+            CHECK(axv_linearSearch(v, x) >= 0 && axv_getComparator(v)(&found, &x) == 0);
+        }
+        axv_destroy(s);
+        axv_destroy(ref);
+        axv_destroy(v);
+    }
+}
+
+
+static void testParallel(void) {
+    // below the threshold, exactly at it and past it by a partial chunk
+    const uint64_t lengths[] = {0, 1000, AXV_PARALLEL_THRESHOLD, 3 * AXV_PARALLEL_THRESHOLD + 5};
+    for (int i = 0; i < 4; ++i)
+        checkParallel(lengths[i]);
+    CHECK(!axv_poolStart(4));
+    for (int i = 0; i < 4; ++i)
+        checkParallel(lengths[i]);
+
+    // the automatic shrink policy applies to both filters alike
+    axvector *v = randomVector(lengths[3], 1000);
+    axv_setAutoShrink(v, true);
+    axvector *ref = axv_copy(v);
+    CHECK(axv_getAutoShrink(ref) && axv_ucap(v) == axv_ucap(ref));
+    CHECK(axv_pfilter(v, isMultipleOf10, NULL) == v && axv_filter(ref, isMultipleOf10, NULL) == ref);
+    CHECK(equals(v, axv_data(ref), axv_ulen(ref)) && axv_ucap(v) == axv_ucap(ref) && axv_ucap(v) < lengths[3] / 4);
+    axv_destroy(ref);
+    axv_destroy(v);
+    axv_poolStop();
+
+    axv_executorfn(runBackwards, NULL);
+    checkParallel(lengths[3]);
+    axv_executorfn(NULL, NULL);
+}
+
+
+static uint64_t growthCalls;
+
+
+// a policy that asks for less than required, which the vector must round up
+static uint64_t growTooLittle(uint64_t cap, uint64_t required, uint64_t param) {
+    (void) cap;
+    (void) required;
+    ++growthCalls;
+    return param;
+}
+
+
+static void testGrowth(void) {
+    CHECK(axv_growGeometric(7, 8, 200) == 15 && axv_growGeometric(100, 101, 150) == 151);
+    CHECK(axv_growGeometric(UINT64_MAX / 4, 0, 200) == UINT64_MAX / 4 * 2 + 1);
+    CHECK(axv_growLinear(10, 11, 5) == 15);
+
+    // every resize by push follows the policy exactly
+    uint64_t (*const policies[])(uint64_t, uint64_t, uint64_t) = {NULL, axv_growGeometric, axv_growLinear};
+    const uint64_t params[] = {0, 150, 10};
+    for (int p = 0; p < 3; ++p) {
+        axvector *v = axv_new();
+        axv_setGrowth(v, policies[p], params[p]);
+        for (uint64_t i = 0; i < 2000; ++i) {
+            const uint64_t cap = axv_ucap(v);
+            CHECK(!axv_push(v, item(i)));
+            if (cap == i)
+                CHECK(axv_ucap(v) == (p == 0 ? axv_growGeometric(cap, i + 1, 200) : policies[p](cap, i + 1, params[p])));
+            else
+                CHECK(axv_ucap(v) == cap);
+        }
+        for (uint64_t i = 0; i < 2000; ++i)
+            CHECK(axv_get(v, i) == item(i));
+        axv_destroy(v);
+    }
+
+    axvector *v = axv_new();
+    axv_setGrowth(v, growTooLittle, 0);
+    growthCalls = 0;
+    CHECK(!axv_reserve(v, 3) && axv_ucap(v) == 7 && growthCalls == 0);
+    CHECK(!axv_reserve(v, 100) && axv_ucap(v) == 100 && growthCalls == 1);
+    CHECK(!axv_reserve(v, 50) && axv_ucap(v) == 100);
+    axv_setGrowth(v, NULL, 0);
+    CHECK(!axv_reserve(v, 101) && axv_ucap(v) == 201);
+
+    // pushing to the front moves the items only when the free slots in front run out, doubling them each time
+    uint64_t moves = 0;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        void **first = axv_data(v);
+        CHECK(!axv_pushFront(v, item(i)));
+        moves += axv_data(v) != first - 1;
+    }
+    CHECK(moves <= 16);
+    for (uint64_t i = 0; i < 10000; ++i)
+        CHECK(axv_get(v, i) == item(9999 - i));
+
+    // reserveFront makes room once and the pushes after it fill the slots in place
+    CHECK(!axv_reserveFront(v, 500));
+    void **first = axv_data(v);
+    for (uint64_t i = 0; i < 500; ++i)
+        CHECK(!axv_pushFront(v, item(i)));
+    CHECK(axv_data(v) == first - 500 && axv_get(v, 0) == item(499) && axv_get(v, 500) == item(9999));
+
+    // once the items popped off the front leave more slack than there are items, reserve reclaims it
+    axv_destroy(v);
+    v = axv_new();
+    for (uint64_t i = 0; i < 100; ++i)
+        axv_push(v, item(i));
+    const uint64_t total = axv_ucap(v);
+    for (uint64_t i = 0; i < 60; ++i)
+        axv_popFront(v);
+    first = axv_data(v);
+    CHECK(axv_ucap(v) == total - 60 && !axv_reserve(v, total) && axv_ucap(v) == total && axv_data(v) == first - 60);
+    for (uint64_t i = 0; i < 40; ++i)
+        CHECK(axv_get(v, i) == item(60 + i));
+
+    // a locked vector can only split the free capacity at its end
+    axv_lock(v, true);
+    const uint64_t spare = axv_ucap(v) - axv_ulen(v);
+    CHECK(axv_reserveFront(v, spare + 1) && !axv_reserveFront(v, 3) && axv_ucap(v) + 3 <= total);
+    CHECK(!axv_pushFront(v, item(7)) && axv_get(v, 0) == item(7) && axv_get(v, 1) == item(60));
+    CHECK(axv_reserve(v, total + 1));
+    axv_lock(v, false);
+    axv_destroy(v);
+}
+
+
+static void testBulk(void) {
+    enum { MAX_LEN = 4096 };
+    static void *ref[MAX_LEN + 64], *src[32];
+    uint64_t len = 0;
+    axvector *v = axv_new();
+    for (int op = 0; op < 20000; ++op) {
+        const uint64_t n = rng() % 32;
+        for (uint64_t k = 0; k < n; ++k)
+            src[k] = item(rng());
+        // indices run one past either end, so that the out of range cases are hit as well
+        const int64_t index = (int64_t) (rng() % (2 * len + 3)) - (int64_t) len - 1;
+        const uint64_t i = index < 0 ? index + len : (uint64_t) index;
+        const bool valid = index >= -(int64_t) len && i <= len;
+        switch (len > MAX_LEN - 32 ? 2 : rng() % 4) {
+        case 0:
+            CHECK(!axv_pushN(v, src, n));
+            memcpy(ref + len, src, n * sizeof(void *));
+            len += n;
+            break;
+        case 1:
+            CHECK(axv_insertN(v, index, src, n) == !valid);
+            if (valid) {
+                memmove(ref + i + n, ref + i, (len - i) * sizeof(void *));
+                memcpy(ref + i, src, n * sizeof(void *));
+                len += n;
+            }
+            break;
+        case 2: {
+            const int64_t index2 = index + (int64_t) n - 8;
+            const uint64_t i2 = index2 < 0 ? index2 + len : (uint64_t) index2;
+            const bool ok = valid && index2 >= -(int64_t) len && i <= i2 && i2 <= len;
+            CHECK(axv_eraseRange(v, index, index2) == !ok);
+            if (ok) {
+                memmove(ref + i, ref + i2, (len - i2) * sizeof(void *));
+                len -= i2 - i;
+            }
+            break;
+        }
+        default: {
+            const int64_t m = (int64_t) n - 16;
+            CHECK(axv_shift(v, index, m) == !valid);
+            if (valid && m > 0) {
+                memmove(ref + i + m, ref + i, (len - i) * sizeof(void *));
+                memset(ref + i, 0, (uint64_t) m * sizeof(void *));
+                len += (uint64_t) m;
+            } else if (valid && m < 0) {
+                const uint64_t removed = (uint64_t) -m < len - i ? (uint64_t) -m : len - i;
+                memmove(ref + i, ref + i + removed, (len - i - removed) * sizeof(void *));
+                len -= removed;
+            }
+        }
+        }
+        CHECK(equals(v, ref, len));
+    }
+    axv_destroy(v);
+
+    // a bulk operation resizes at most once, to exactly what the policy returns
+    v = axv_new();
+    axv_setGrowth(v, growTooLittle, 0);
+    growthCalls = 0;
+    CHECK(!axv_pushN(v, ref, 1000) && axv_ucap(v) == 1000 && growthCalls == 1);
+    CHECK(!axv_insertN(v, 10, ref, 1000) && axv_ucap(v) == 2000 && growthCalls == 2);
+    CHECK(!axv_pushN(v, ref, 0) && !axv_insertN(v, -1, ref, 0) && !axv_eraseRange(v, 5, 5) && growthCalls == 2);
+    CHECK(axv_ulen(v) == 2000 && axv_get(v, 10) == ref[0] && axv_get(v, 1010) == ref[10]);
+    axv_destroy(v);
+}
+
+
+typedef struct destroyLog {
+    uint64_t calls;
+    uint64_t items;
+    uint8_t seen[4096];
+} destroyLog;
+
+
+static void logBatch(void **items, uint64_t n, void *context) {
+    destroyLog *log = context;
+    ++log->calls;
+    for (uint64_t i = 0; i < n; ++i) {
+        ++log->seen[(uintptr_t) items[i]];
+        ++log->items;
+    }
+}
+
+
+static uint64_t singleCalls;
+
+
+static void countSingle(void *x) {
+    (void) x;
+    ++singleCalls;
+}
+
+
+static bool isBelow1000(const void *x, void *arg) {
+    (void) arg;
+    return (uintptr_t) x < 1000;
+}
+
+
+static void testBatchDestructor(void) {
+    static destroyLog log;
+    memset(&log, 0, sizeof log);
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < 4096; ++i)
+        axv_push(v, item(i));
+    axv_setContext(v, &log);
+    axv_setDestructor(v, countSingle);
+    axv_setBatchDestructor(v, logBatch);
+    singleCalls = 0;
+
+    // every removal hands over its items as one run, or as few runs as its batch buffer needs
+    CHECK(!axv_eraseRange(v, 3000, 3500) && log.calls == 1 && log.items == 500);
+    CHECK(axv_discard(v, 96) == v && log.calls == 2 && log.items == 596);
+    CHECK(!axv_shift(v, 100, -50) && log.calls == 3 && log.items == 646);
+    CHECK(!axv_shift(v, 0, -50) && log.calls == 4 && log.items == 696);
+    CHECK(axv_filter(v, isBelow1000, NULL) == v && log.items == 3196 && axv_ulen(v) == 900);
+    CHECK(!axv_resize(v, 800) && log.items == 3296);
+    CHECK(!axv_eraseRange(v, 10, 10) && axv_discard(v, 0) == v && log.items == 3296);
+    const uint64_t calls = log.calls;
+    axv_destroy(v);
+    CHECK(log.calls == calls + 1 && log.items == 4096 && singleCalls == 0);
+    for (uint64_t i = 0; i < 4096; ++i)
+        CHECK(log.seen[i] == 1);
+
+    // without a batch destructor the destructor is called per item, and never on an empty run
+    v = axv_new();
+    for (uint64_t i = 0; i < 100; ++i)
+        axv_push(v, item(i));
+    axv_setDestructor(v, countSingle);
+    CHECK(!axv_eraseRange(v, 0, 10) && singleCalls == 10);
+    axv_clear(v);
+    CHECK(singleCalls == 100 && axv_ulen(v) == 0);
+    axv_setBatchDestructor(v, logBatch);
+    axv_setContext(v, &log);
+    axv_clear(v);
+    axv_destroy(v);
+    CHECK(log.calls == calls + 1 && singleCalls == 100);
+}
+
+
+/*
+    An allocator that checks what the library does with it: every block carries the size it was requested with, which
+    realloc and free must be passed back, and the bytes still allocated are tracked. Once budget calls to alloc or
+    realloc have succeeded, the following ones fail, to test running out of memory.
+*/
+typedef struct testArena {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t live;
+    uint64_t badSizes;
+    uint64_t budget;
+} testArena;
+
+
+#define BLOCK_HEADER 16
+
+
+static void *arenaAlloc(size_t size, void *ctx) {
+    testArena *a = ctx;
+    if (a->budget == 0)
+        return NULL;
+    --a->budget;
+    char *p = malloc(size + BLOCK_HEADER);
+    if (!p)
+        return NULL;
+    memcpy(p, &size, sizeof size);
+    // fresh blocks are filled with garbage, so nothing relies on them being zeroed
+    memset(p + BLOCK_HEADER, 0xa5, size);
+    ++a->allocs;
+    a->live += size;
+    return p + BLOCK_HEADER;
+}
+
+
+static void arenaFree(void *ptr, size_t size, void *ctx) {
+    testArena *a = ctx;
+    char *p = (char *) ptr - BLOCK_HEADER;
+    size_t stored;
+    memcpy(&stored, p, sizeof stored);
+    a->badSizes += stored != size;
+    ++a->frees;
+    a->live -= stored;
+    free(p);
+}
+
+
+static void *arenaRealloc(void *ptr, size_t oldSize, size_t size, void *ctx) {
+    testArena *a = ctx;
+    if (a->budget == 0)
+        return NULL;
+    --a->budget;
+    char *p = (char *) ptr - BLOCK_HEADER;
+    size_t stored;
+    memcpy(&stored, p, sizeof stored);
+    a->badSizes += stored != oldSize;
+    char *q = realloc(p, size + BLOCK_HEADER);
+    if (!q)
+        return NULL;
+    memcpy(q, &size, sizeof size);
+    a->live += size - stored;
+    return q + BLOCK_HEADER;
+}
+
+
+static uint64_t identityKey(const void *x) {
+    return (uintptr_t) x;
+}
+
+
+static void testAllocator(void) {
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    axvector *v = axv_newWithAllocator(0, &allocator);
+    CHECK(v && axv_getAllocator(v) == &allocator && arena.allocs == 1);
+    for (uint64_t i = 0; i < 5000; ++i)
+        axv_push(v, item(rng() % 3000));
+
+    // every vector derived from v and every scratch buffer comes from the same allocator
+    axvector *derived[] = {axv_copy(v), axv_slice(v, 10, -10), axv_rslice(v, 0, 100), axv_snapshot(v),
+                           axv_partition(v, isBelow1000, NULL)};
+    const uint64_t allocs = arena.allocs;
+    for (int i = 0; i < 5; ++i)
+        CHECK(derived[i] && axv_getAllocator(derived[i]) == &allocator);
+    CHECK(!axv_stableSort(derived[0]) && !axv_sortByKey(derived[1], identityKey) && !axv_dedupe(derived[2]));
+    CHECK(axv_set(derived[3], 0, NULL) == false && arena.allocs > allocs);
+    axv_setHash(v, axv_hashAddress);
+    CHECK(axv_linearSearch(v, axv_get(v, 7)) >= 0);
+    CHECK(!axv_shrinkToFit(v) && !axv_reserveFront(v, 100));
+    for (int i = 0; i < 5; ++i)
+        axv_destroy(derived[i]);
+    axv_destroy(v);
+    CHECK(arena.live == 0 && arena.badSizes == 0 && arena.frees == arena.allocs);
+
+    // running out of memory leaves everything as it was, and nothing leaks
+    for (uint64_t budget = 0; budget < 8; ++budget) {
+        arena.budget = UINT64_MAX;
+        v = axv_newWithAllocator(0, &allocator);
+        for (uint64_t i = 0; i < 100; ++i)
+            axv_push(v, item(i));
+        arena.budget = budget;
+        bool failed = false;
+        for (uint64_t i = 100; i < 100000 && !failed; ++i)
+            failed = axv_push(v, item(i));
+        CHECK(failed && axv_ulen(v) >= 100);
+        for (uint64_t i = 0; i < axv_ulen(v); ++i)
+            CHECK(axv_get(v, i) == item(i));
+        arena.budget = 0;
+        const uint64_t len = axv_ulen(v);
+        CHECK(!axv_copy(v) && !axv_slice(v, 0, 10) && axv_stableSort(v) && axv_ulen(v) == len);
+        CHECK(axv_reserve(v, axv_ucap(v) + 1) && axv_ulen(v) == len && axv_get(v, len - 1) == item(len - 1));
+        axv_destroy(v);
+        CHECK(arena.live == 0 && arena.badSizes == 0);
+    }
+    CHECK(!axv_newWithAllocator(100, &allocator));
+}
+
+
+// whether the items of v are stored inline, i.e. right behind the vector in the same block
+static bool isInline(axvector *v) {
+    void **const items = axv_data(v), **const inlineItems = (void **) (v + 1);
+    return items >= inlineItems && items < inlineItems + AXV_INLINE_CAP;
+}
+
+
+static void testInline(void) {
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    axvector *v = axv_newWithAllocator(AXV_INLINE_CAP, &allocator);
+    CHECK(arena.allocs == 1 && isInline(v) && axv_ucap(v) == AXV_INLINE_CAP);
+    for (uint64_t i = 0; i < AXV_INLINE_CAP; ++i)
+        CHECK(!axv_push(v, item(i)));
+    CHECK(arena.allocs == 1 && isInline(v));
+
+    // spilling moves the items to the heap, shrinking brings them back and releases the heap array
+    CHECK(!axv_push(v, item(AXV_INLINE_CAP)) && arena.allocs == 2 && !isInline(v));
+    const uint64_t header = arena.live - axv_ucap(v) * sizeof(void *);
+    axv_pop(v);
+    CHECK(!axv_shrinkToFit(v) && isInline(v) && arena.frees == 1 && arena.live == header);
+    for (uint64_t i = 0; i < AXV_INLINE_CAP; ++i)
+        CHECK(axv_get(v, i) == item(i));
+
+    // repeatedly crossing the boundary in either direction, by every function that resizes
+    for (int round = 0; round < 3; ++round) {
+        CHECK(!axv_resize(v, 4 * AXV_INLINE_CAP) && !isInline(v));
+        CHECK(!axv_resize(v, AXV_INLINE_CAP / 2) && isInline(v) && axv_ulen(v) == AXV_INLINE_CAP / 2);
+        CHECK(!axv_reserveFront(v, 2) && !axv_pushFront(v, item(100)) && !axv_pushFront(v, item(101)));
+        CHECK(axv_get(v, 0) == item(101) && axv_get(v, 2) == item(0) && axv_ulen(v) == AXV_INLINE_CAP / 2 + 2);
+        CHECK(!axv_shrinkToFit(v) && isInline(v) && axv_get(v, 1) == item(100));
+        CHECK(axv_popFront(v) == item(101) && axv_popFront(v) == item(100));
+        axvector *s = axv_snapshot(v);
+        CHECK(s && !axv_isShared(v) && !axv_isShared(s) && isInline(s) && axv_compare(s, v));
+        axv_destroy(s);
+        for (uint64_t i = AXV_INLINE_CAP / 2; i < AXV_INLINE_CAP; ++i)
+            axv_push(v, item(i));
+    }
+    for (uint64_t i = 0; i < AXV_INLINE_CAP; ++i)
+        CHECK(axv_get(v, i) == item(i));
+    axv_destroy(v);
+    CHECK(arena.live == 0 && arena.badSizes == 0 && arena.frees == arena.allocs);
+}
+
+
+static void testInit(void) {
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    struct {
+        uint64_t before;
+        axvector v;
+        uint64_t after;
+    } embedding = {42, {0}, 43};
+    axvector *v = &embedding.v;
+
+    // only the items are allocated, never the vector itself
+    CHECK(!axv_initWithAllocator(v, 4, &allocator) && arena.allocs == 1 && arena.live == 4 * sizeof(void *));
+    for (uint64_t i = 0; i < 1000; ++i)
+        axv_push(v, item(i));
+    axv_setContext(v, &embedding);
+    axv_setDestructor(v, countSingle);
+    singleCalls = 0;
+    CHECK(!axv_resize(v, 3) && singleCalls == 997 && axv_ulen(v) == 3 && arena.live == 3 * sizeof(void *));
+    for (uint64_t i = 3; i < 100; ++i)
+        axv_push(v, item(i));
+
+    // a snapshot keeps the shared array alive after the vector is released
+    axvector *s = axv_snapshot(v);
+    CHECK(s && axv_isShared(v) && axv_getAllocator(s) == &allocator);
+    CHECK(axv_deinit(v) == &embedding && singleCalls == 1097);
+    CHECK(axv_ulen(s) == 100 && axv_get(s, 99) == item(99) && arena.live > 0);
+    axv_destroy(s);
+    CHECK(arena.live == 0 && arena.badSizes == 0 && embedding.before == 42 && embedding.after == 43);
+
+    // axv_destroy() only deinitialises, it must not free the embedding
+    CHECK(!axv_initWithAllocator(v, 0, &allocator) && !axv_push(v, item(1)));
+    CHECK(axv_destroy(v) == NULL && arena.live == 0 && arena.frees == arena.allocs);
+    arena.budget = 0;
+    CHECK(axv_initWithAllocator(v, 10, &allocator));
+
+    // a buffer is used until it is outgrown, then the items move to the heap and the buffer is left as it was
+    void *buffer[16];
+    axv_initBuffer(v, buffer, 16);
+    CHECK(axv_isOverlay(v) && !axv_isLocked(v) && axv_ucap(v) == 16);
+    for (uint64_t i = 0; i < 16; ++i)
+        CHECK(!axv_push(v, item(i)));
+    CHECK(axv_data(v) == buffer && axv_isOverlay(v));
+    axvector *c = axv_snapshot(v);
+    CHECK(c && !axv_isShared(v) && axv_compare(c, v));
+    axv_destroy(c);
+    CHECK(!axv_push(v, item(16)) && axv_data(v) != buffer && !axv_isOverlay(v));
+    for (uint64_t i = 0; i < 17; ++i)
+        CHECK(axv_get(v, i) == item(i) && (i == 16 || buffer[i] == item(i)));
+    CHECK(!axv_resize(v, 2) && axv_data(v) != buffer && axv_ulen(v) == 2);
+    axv_deinit(v);
+
+    CHECK(!axv_init(v, 0) && axv_ucap(v) == 1 && !axv_push(v, item(5)) && axv_pop(v) == item(5));
+    axv_deinit(v);
+}
+
+
+static int64_t scan(axvector *v, void *val) {
+    for (uint64_t i = 0; i < axv_ulen(v); ++i) {
+        if (axv_get(v, i) == val)
+            return (int64_t) i;
+    }
+    return -1;
+}
+
+
+static uint64_t countScan(axvector *v, void *val) {
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < axv_ulen(v); ++i)
+        n += axv_get(v, i) == val;
+    return n;
+}
+
+
+/*
+    Checks the kernels used with the default comparator against plain loops, on every length up to a few SIMD widths
+    and at every offset within a cache line, so that the vector loops, their tails and unaligned accesses are all
+    covered. The build runs this for each set of kernels by compiling the library with AXV_NO_AVX512 and AXV_NO_SIMD.
+*/
+static void testKernels(void) {
+    void *pool[] = {item(0), item(1), item(UINTPTR_MAX), item(UINTPTR_MAX - 1), item(UINT64_C(1) << 63),
+                    item((UINT64_C(1) << 63) + 1), item(rng()), item(rng() | UINT64_C(1) << 63)};
+    const uint64_t poolSize = sizeof pool / sizeof *pool;
+    void *ref[100], *prefix[8];
+    for (uint64_t n = 0; n <= 100; ++n) {
+        for (uint64_t off = 0; off < 8; ++off) {
+            axvector *v = axv_new();
+            for (uint64_t i = 0; i < off + n; ++i)
+                axv_push(v, pool[rng() % (n % 3 ? poolSize : poolSize / 2)]);
+            memcpy(prefix, axv_data(v), off * sizeof(void *));
+            axvector w = axv_view(v, (int64_t) off, (int64_t) (off + n));
+            memcpy(ref, axv_data(&w), n * sizeof(void *));
+
+            for (uint64_t k = 0; k < poolSize; ++k) {
+                CHECK(axv_linearSearch(&w, pool[k]) == scan(&w, pool[k]));
+                CHECK(axv_count(&w, pool[k]) == countScan(&w, pool[k]));
+            }
+            uintptr_t max = 0, min = UINTPTR_MAX;
+            for (uint64_t i = 0; i < n; ++i) {
+                max = (uintptr_t) ref[i] > max ? (uintptr_t) ref[i] : max;
+                min = (uintptr_t) ref[i] < min ? (uintptr_t) ref[i] : min;
+            }
+            CHECK(axv_max(&w) == (n ? item(max) : NULL) && axv_min(&w) == (n ? item(min) : NULL));
+
+            axvector *r = axv_rslice(&w, 0, (int64_t) n);
+            CHECK(r && axv_ulen(r) == n);
+            for (uint64_t i = 0; r && i < n; ++i)
+                CHECK(axv_get(r, i) == ref[n - 1 - i]);
+            axv_destroy(r);
+
+            axv_reverse(&w);
+            for (uint64_t i = 0; i < n; ++i)
+                CHECK(axv_get(&w, i) == ref[n - 1 - i]);
+            if (n > 1) {
+                CHECK(!axv_reverseSection(&w, 1, (int64_t) n));
+                for (uint64_t i = 1; i < n; ++i)
+                    CHECK(axv_get(&w, i) == ref[i - 1]);
+            }
+            for (uint64_t i = 0; i < off; ++i)
+                CHECK(axv_get(v, i) == prefix[i]);
+            axv_destroy(v);
+        }
+    }
+}
+
+
+typedef struct point {
+    int64_t key;
+    uint32_t tag;
+} point;
+
+
+AXV_DECLARE(intvec, int, (a > b) - (a < b))
+AXV_DECLARE_PREDICATE(intvec, Even, x % 2 == 0)
+AXV_DECLARE(pointvec, point, (a.key > b.key) - (a.key < b.key))
+AXV_DECLARE_PREDICATE(pointvec, Negative, x.key < 0)
+
+
+static bool isOddInt(const int *x, void *arg) {
+    (void) arg;
+    return *x % 2 != 0;
+}
+
+
+static bool hasTag(const point *p, void *arg) {
+    return p->tag == *(uint32_t *) arg;
+}
+
+
+static int compareInts(const void *a, const void *b) {
+    const int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+
+static void testTyped(void) {
+    enum {N = 3000};
+    static int ref[N];
+    intvec *v = intvec_new();
+    CHECK(v && intvec_len(v) == 0 && !intvec_top(v) && intvec_pop(v) == 0 && !intvec_at(v, 0));
+    for (int i = 0; i < N; ++i) {
+        ref[i] = (int) (rng() % 2001) - 1000;
+        CHECK(!intvec_push(v, ref[i]));
+    }
+    CHECK(intvec_ulen(v) == N && intvec_ucap(v) >= N && *intvec_top(v) == ref[N - 1]);
+    CHECK(*intvec_at(v, -1) == ref[N - 1] && *intvec_at(v, -N) == ref[0] && !intvec_at(v, N) && !intvec_at(v, -N - 1));
+    bool same = true;
+    for (uint64_t i = 0; i < N; ++i)
+        same &= *intvec_get(v, i) == ref[i];
+    CHECK(same && !intvec_get(v, N));
+    CHECK(!intvec_set(v, -2, 5000) && *intvec_get(v, N - 2) == 5000 && intvec_set(v, N, 0));
+    ref[N - 2] = 5000;
+
+    // the predicate forms agree with a loop over the array, and with the function pointer forms
+    uint64_t evens = 0;
+    for (int i = 0; i < N; ++i)
+        evens += ref[i] % 2 == 0;
+    CHECK(intvec_countEven(v) == evens && intvec_anyEven(v) == (evens > 0) && !intvec_allEven(v));
+    CHECK(intvec_any(v, isOddInt, NULL) == (evens < N));
+    intvec *odds = intvec_slice(v, 0, N);
+    CHECK(odds && intvec_ulen(odds) == N && intvec_filter(odds, isOddInt, NULL) == odds);
+    CHECK(intvec_filterEven(v) == v && intvec_ulen(v) == evens && intvec_allEven(v) && !intvec_anyEven(odds));
+    CHECK(intvec_ulen(odds) == N - evens && intvec_countEven(odds) == 0);
+    uint64_t e = 0, o = 0;
+    same = true;
+    for (int i = 0; i < N; ++i) {
+        if (ref[i] % 2 == 0)
+            same &= *intvec_get(v, e++) == ref[i];
+        else
+            same &= *intvec_get(odds, o++) == ref[i];
+    }
+    CHECK(same);
+    intvec_destroy(odds);
+
+    // sort against qsort, then search the sorted vector
+    intvec_clear(v);
+    for (int i = 0; i < N; ++i)
+        intvec_push(v, ref[i]);
+    qsort(ref, N, sizeof *ref, compareInts);
+    CHECK(intvec_sort(v) == v && memcmp(intvec_data(v), ref, sizeof ref) == 0);
+    CHECK(intvec_binarySearch(v, 5000) == N - 1 && intvec_binarySearch(v, 1001) == -1);
+    const int64_t found = intvec_binarySearch(v, ref[N / 2]);
+    CHECK(found >= 0 && *intvec_get(v, found) == ref[N / 2] && intvec_linearSearch(v, 1001) == -1);
+    CHECK(ref[intvec_linearSearch(v, ref[N / 3])] == ref[N / 3]);
+    CHECK(intvec_pop(v) == 5000 && intvec_ulen(v) == N - 1);
+    CHECK(!intvec_shift(v, 0, 2) && *intvec_get(v, 0) == 0 && *intvec_get(v, 1) == 0 && *intvec_get(v, 2) == ref[0]);
+    CHECK(!intvec_shift(v, 0, -2) && *intvec_get(v, 0) == ref[0] && intvec_shift(v, N, 1));
+    CHECK(!intvec_resize(v, 10) && intvec_ulen(v) == 10 && intvec_ucap(v) == 10);
+    intvec_destroy(v);
+
+    // a struct sorts by the key in its comparator expression and keeps every value intact
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    static int64_t keys[N];
+    pointvec p;
+    CHECK(!pointvec_initWithAllocator(&p, 0, &allocator));
+    for (uint32_t i = 0; i < N; ++i) {
+        keys[i] = (int64_t) (rng() % 100) - 50;
+        CHECK(!pointvec_push(&p, (point) {keys[i], i}));
+    }
+    uint64_t negatives = 0;
+    for (int i = 0; i < N; ++i)
+        negatives += keys[i] < 0;
+    pointvec_sort(&p);
+    bool sorted = true, intact = true;
+    uint64_t seen = 0;
+    for (uint64_t i = 0; i < N; ++i) {
+        const point *q = pointvec_get(&p, i);
+        sorted &= i == 0 || q[-1].key <= q->key;
+        intact &= q->tag < N && keys[q->tag] == q->key;
+        seen += q->tag;
+    }
+    CHECK(sorted && intact && seen == (uint64_t) N * (N - 1) / 2);
+    uint32_t tag = 17;
+    CHECK(pointvec_any(&p, hasTag, &tag) && pointvec_countNegative(&p) == negatives);
+    CHECK(pointvec_filterNegative(&p) == &p && pointvec_ulen(&p) == negatives && pointvec_allNegative(&p));
+    CHECK(pointvec_any(&p, hasTag, &tag) == (keys[tag] < 0));
+    pointvec_deinit(&p);
+    CHECK(arena.live == 0 && arena.badSizes == 0 && arena.frees == arena.allocs);
+}
+
+
+typedef struct {
+    void **items;
+    uint64_t n;
+    uint64_t limit;
+} collector;
+
+
+static bool collect(void *x, void *arg) {
+    collector *r = arg;
+    r->items[r->n++] = x;
+    return r->n < r->limit;
+}
+
+
+static void testViews(void) {
+    enum {N = 50};
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < N; ++i)
+        axv_push(v, item(i % 7));
+
+    // a view writes through to the original and cannot be resized
+    axvector view = axv_view(v, 10, -10);
+    CHECK(axv_ulen(&view) == N - 20 && axv_get(&view, 0) == axv_get(v, 10));
+    CHECK(!axv_set(&view, 0, item(100)) && axv_get(v, 10) == item(100) && axv_push(&view, NULL));
+    CHECK(axv_count(&view, item(100)) == 1 && axv_ulen(v) == N);
+    axv_set(v, 10, item(10 % 7));
+    view = axv_view(v, 30, 20);
+    CHECK(axv_ulen(&view) == 0);
+
+    // every strided view visits exactly the indices a loop over the section with that step visits
+    static const int64_t bounds[] = {0, 1, 6, 25, N - 1, N, -1, -7, -N, -N - 5, N + 5};
+    static const int64_t strides[] = {1, 2, 3, 7, N - 1, N, N + 1, -1, -2, -3, -7, -N, -N - 1, 0};
+    const uint64_t nb = sizeof bounds / sizeof *bounds, ns = sizeof strides / sizeof *strides;
+    void *seen[N + 1], *expected[N + 1];
+    bool same = true;
+    for (uint64_t a = 0; a < nb; ++a) {
+        for (uint64_t b = 0; b < nb; ++b) {
+            int64_t i1 = bounds[a] + (bounds[a] < 0) * N, i2 = bounds[b] + (bounds[b] < 0) * N;
+            i1 = i1 < 0 ? 0 : i1 > N ? N : i1;
+            i2 = i2 < i1 ? i1 : i2 > N ? N : i2;
+            for (uint64_t s = 0; s < ns; ++s) {
+                const int64_t stride = strides[s];
+                uint64_t n = 0;
+                if (stride > 0) {
+                    for (int64_t i = i1; i < i2; i += stride)
+                        expected[n++] = axv_get(v, i);
+                } else if (stride < 0) {
+                    for (int64_t i = i2 - 1; i >= i1; i += stride)
+                        expected[n++] = axv_get(v, i);
+                }
+                axview w = axv_stridedView(v, bounds[a], bounds[b], stride);
+                collector r = {seen, 0, UINT64_MAX};
+                axv_viewForeach(&w, collect, &r);
+                same &= axv_viewLen(&w) == n && r.n == n && memcmp(seen, expected, n * sizeof(void *)) == 0;
+                same &= w.base >= axv_data(v) && w.base <= axv_data(v) + N;
+                for (uint64_t i = 0; i < n; ++i)
+                    same &= axv_viewAt(&w, i) == expected[i] && axv_viewAt(&w, (int64_t) i - n) == expected[i];
+                same &= !axv_viewAt(&w, n) && !axv_viewAt(&w, -(int64_t) n - 1);
+                uint64_t zeros = 0;
+                for (uint64_t i = 0; i < n; ++i)
+                    zeros += expected[i] == NULL;
+                same &= axv_viewCount(&w, NULL) == zeros && axv_viewAny(&w, isZero, NULL) == (zeros > 0);
+                same &= axv_viewAll(&w, isZero, NULL) == (zeros == n);
+            }
+        }
+    }
+    CHECK(same);
+
+    // a reverse view is a strided view with stride -1, and foreach stops when the function returns false
+    axview w = axv_rview(v, 0, N);
+    axvector *reversed = axv_rslice(v, 0, N);
+    collector r = {seen, 0, 5};
+    CHECK(axv_viewForeach(&w, collect, &r) == &w && r.n == 5);
+    CHECK(memcmp(seen, axv_data(reversed), 5 * sizeof(void *)) == 0);
+    r = (collector) {seen, 0, UINT64_MAX};
+    axv_viewForeach(&w, collect, &r);
+    CHECK(r.n == N && memcmp(seen, axv_data(reversed), N * sizeof(void *)) == 0);
+    axv_destroy(reversed);
+    axv_destroy(v);
+}
+
+
+static void testDeque(void) {
+    enum {M = 4096};
+    static void *ref[2 * M];
+    uint64_t lo = M, hi = M;
+    axvector *v = axv_new();
+    bool same = true;
+    for (uint64_t round = 0; round < 20000; ++round) {
+        const uint64_t op = rng() % 8;
+        if (op < 2 && hi - lo < M - 1) {
+            ref[--lo] = item(round);
+            same &= !axv_pushFront(v, item(round));
+        } else if (op < 4 && hi - lo < M - 1) {
+            ref[hi++] = item(round);
+            same &= !axv_push(v, item(round));
+        } else if (op < 6) {
+            same &= axv_popFront(v) == (hi > lo ? ref[lo++] : NULL);
+        } else if (op < 7) {
+            same &= axv_pop(v) == (hi > lo ? ref[--hi] : NULL);
+        } else if (hi > lo) {
+            // removing the first item with shift advances the items in place like popFront
+            void **first = axv_data(v);
+            same &= !axv_shift(v, 0, -1) && axv_data(v) == first + 1;
+            ++lo;
+        }
+        if (lo < M / 4 || hi > 2 * M - M / 4) {
+            const uint64_t n = hi - lo;
+            memmove(ref + M - n / 2, ref + lo, n * sizeof(void *));
+            lo = M - n / 2;
+            hi = lo + n;
+        }
+        same &= axv_ulen(v) == hi - lo && axv_peekFront(v) == (hi > lo ? ref[lo] : NULL);
+        same &= axv_top(v) == (hi > lo ? ref[hi - 1] : NULL);
+        if (round % 97 == 0)
+            same &= equals(v, ref + lo, hi - lo) && axv_at(v, -1) == axv_top(v);
+    }
+    CHECK(same && equals(v, ref + lo, hi - lo));
+    axv_destroy(v);
+
+    // a FIFO that never holds more than a few items does not keep growing, however many pass through it
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    v = axv_newWithAllocator(0, &allocator);
+    uint64_t next = 0, peak = 0;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        axv_push(v, item(i));
+        if (axv_ulen(v) > 10)
+            same &= axv_popFront(v) == item(next++);
+        peak = arena.live > peak ? arena.live : peak;
+    }
+    CHECK(same && axv_ulen(v) == 10 && peak < 1024);
+    axv_destroy(v);
+    CHECK(arena.live == 0 && arena.badSizes == 0);
+}
+
+
+#define QUEUE_ITEMS 20000
+
+
+// moves items through q in runs of random length and checks they come out in order, as from a plain array
+static bool cycleSpsc(axv_spsc *q, uint64_t rounds) {
+    static void *ref[1 << 16];
+    void *buf[64];
+    uint64_t in = 0, out = 0;
+    bool same = true;
+    const uint64_t cap = axv_spscCap(q);
+    for (uint64_t r = 0; r < rounds; ++r) {
+        uint64_t n = rng() % 40;
+        for (uint64_t i = 0; i < n; ++i)
+            buf[i] = ref[(in + i) % (1 << 16)] = item(rng());
+        const uint64_t fit = n < cap - (in - out) ? n : cap - (in - out);
+        if (r % 3 == 0) {
+            uint64_t pushed = 0;
+            while (pushed < n && !axv_spscPush(q, buf[pushed]))
+                ++pushed;
+            same &= pushed == fit;
+        } else {
+            same &= axv_spscPushN(q, buf, n) == fit;
+        }
+        in += fit;
+        same &= axv_spscLen(q) == in - out;
+        n = rng() % 40;
+        const uint64_t avail = n < in - out ? n : in - out;
+        if (r % 5 == 0) {
+            uint64_t popped = 0;
+            while (popped < n && !axv_spscPop(q, buf + popped))
+                ++popped;
+            same &= popped == avail;
+        } else {
+            same &= axv_spscPopN(q, buf, n) == avail;
+        }
+        for (uint64_t i = 0; i < avail; ++i)
+            same &= buf[i] == ref[(out + i) % (1 << 16)];
+        out += avail;
+    }
+    return same;
+}
+
+
+static void *produceSpsc(void *q) {
+    void *buf[16];
+    uint64_t next = 1;
+    while (next <= QUEUE_ITEMS) {
+        uint64_t n = 1 + next % 16;
+        n = next + n > QUEUE_ITEMS + 1 ? QUEUE_ITEMS + 1 - next : n;
+        for (uint64_t i = 0; i < n; ++i)
+            buf[i] = item(next + i);
+        const uint64_t pushed = axv_spscPushN(q, buf, n);
+        next += pushed;
+        if (pushed == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+
+static void *produce(void *q) {
+    static _Atomic uint64_t producers;
+    const uint64_t id = atomic_fetch_add(&producers, 1) % 2;
+    for (uint64_t i = 1; i <= QUEUE_ITEMS; ++i) {
+        while (axv_mpmcPush(q, item(id << 32 | i)))
+            sched_yield();
+    }
+    return NULL;
+}
+
+
+static void *consume(void *q) {
+    uint64_t *result = calloc(2, sizeof *result);
+    uint64_t last[2] = {0, 0};
+    for (uint64_t n = 0; n < QUEUE_ITEMS; ++n) {
+        void *val;
+        while (axv_mpmcPop(q, &val))
+            sched_yield();
+        const uint64_t id = (uintptr_t) val >> 32, i = (uintptr_t) val & 0xffffffff;
+        // every consumer sees the items of each producer in the order they were pushed
+        result[1] += id > 1 || i <= last[id];
+        last[id & 1] = i;
+        result[0] += i;
+    }
+    return result;
+}
+
+
+static void testQueue(void) {
+    // the capacity is rounded up, and the ring wraps around many times without losing the order
+    axv_spsc *s = axv_spscNew(5, NULL);
+    CHECK(s && axv_spscCap(s) == 8 && axv_spscLen(s) == 0);
+    CHECK(cycleSpsc(s, 5000));
+    axv_spscDestroy(s);
+    s = axv_spscNew(64, NULL);
+    CHECK(s && axv_spscCap(s) == 64 && cycleSpsc(s, 5000));
+    axv_spscDestroy(s);
+
+    // an overlay ring stores the items in the caller's array, using only a power of two of its slots
+    void *ring[10] = {NULL};
+    CHECK(!axv_spscNewOverlay(ring, 0, NULL));
+    s = axv_spscNewOverlay(ring, 10, NULL);
+    CHECK(s && axv_spscCap(s) == 8);
+    for (uint64_t i = 0; i < 8; ++i)
+        CHECK(!axv_spscPush(s, item(i + 1)));
+    void *val = NULL;
+    CHECK(axv_spscPush(s, item(9)) && axv_spscLen(s) == 8);
+    for (uint64_t i = 0; i < 8; ++i)
+        CHECK(ring[i] == item(i + 1));
+    CHECK(!axv_spscPop(s, &val) && val == item(1) && !axv_spscPop(s, &val) && val == item(2));
+    CHECK(!axv_spscPush(s, item(9)) && !axv_spscPush(s, item(10)) && ring[0] == item(9) && ring[1] == item(10));
+    CHECK(ring[8] == NULL && ring[9] == NULL);
+    void *out[8];
+    CHECK(axv_spscPopN(s, out, 8) == 8 && axv_spscPop(s, &val) && axv_spscLen(s) == 0);
+    for (uint64_t i = 0; i < 8; ++i)
+        CHECK(out[i] == item(i + 3));
+    CHECK(cycleSpsc(s, 2000));
+    axv_spscDestroy(s);
+
+    // a producer thread pushing runs arrives in order at the consumer
+    s = axv_spscNew(32, NULL);
+    pthread_t producer;
+    pthread_create(&producer, NULL, produceSpsc, s);
+    uint64_t expected = 1;
+    bool inOrder = true;
+    while (expected <= QUEUE_ITEMS) {
+        const uint64_t n = axv_spscPopN(s, out, 1 + expected % 8);
+        for (uint64_t i = 0; i < n; ++i)
+            inOrder &= out[i] == item(expected++);
+        if (n == 0)
+            sched_yield();
+    }
+    pthread_join(producer, NULL);
+    CHECK(inOrder && axv_spscPop(s, &val));
+    axv_spscDestroy(s);
+
+    // single-threaded, the MPMC queue is a FIFO of fixed capacity, and runs pushed at once stay together
+    axv_mpmc *q = axv_mpmcNew(48, NULL);
+    CHECK(q && axv_mpmcCap(q) == 64);
+    void *src[100];
+    for (uint64_t i = 0; i < 100; ++i)
+        src[i] = item(i % 50);
+    uint64_t in = 0, popped = 0;
+    bool same = true;
+    for (uint64_t r = 0; r < 3000; ++r) {
+        const uint64_t n = rng() % 30;
+        uint64_t pushed = 0;
+        while (pushed < n) {
+            const uint64_t m = axv_mpmcPushN(q, src + (in + pushed) % 50, n - pushed);
+            if (m == 0)
+                break;
+            pushed += m;
+        }
+        same &= pushed == (n < 64 - (in - popped) ? n : 64 - (in - popped));
+        in += pushed;
+        void *dst[30];
+        const uint64_t m = axv_mpmcPopN(q, dst, rng() % 30);
+        for (uint64_t i = 0; i < m; ++i)
+            same &= dst[i] == src[(popped + i) % 50];
+        popped += m;
+    }
+    CHECK(same);
+    while (!axv_mpmcPop(q, &val))
+        CHECK(val == src[popped++ % 50]);
+    CHECK(popped == in && axv_mpmcPopN(q, out, 8) == 0);
+    axv_mpmcDestroy(q);
+
+    // two producers and two consumers through a small queue lose nothing and keep each producer's order
+    q = axv_mpmcNew(64, NULL);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i)
+        pthread_create(threads + i, NULL, i < 2 ? produce : consume, q);
+    uint64_t sum = 0, disorder = 0;
+    for (int i = 0; i < 4; ++i) {
+        void *result;
+        pthread_join(threads[i], &result);
+        if (result) {
+            sum += ((uint64_t *) result)[0];
+            disorder += ((uint64_t *) result)[1];
+            free(result);
+        }
+    }
+    CHECK(sum == (uint64_t) QUEUE_ITEMS * (QUEUE_ITEMS + 1) && disorder == 0);
+    CHECK(axv_mpmcPop(q, &val));
+    axv_mpmcDestroy(q);
+}
+
+
+#define CVEC_RUNS 2000
+
+
+static void *pushRuns(void *cv) {
+    static _Atomic uint64_t pushers;
+    const uint64_t id = atomic_fetch_add(&pushers, 1) % 4;
+    void *run[8];
+    for (uint64_t r = 0; r < CVEC_RUNS; ++r) {
+        const uint64_t n = 1 + r % 8;
+        for (uint64_t i = 0; i < n; ++i)
+            run[i] = item(id << 40 | r << 8 | i);
+        if (axv_cvecPushN(cv, run, n))
+            return cv;
+    }
+    return NULL;
+}
+
+
+static void testCvec(void) {
+    // runs straddling the ends of the first segments at 64 and 192 slots land in slot order
+    enum {N = 1000};
+    static void *ref[N];
+    axv_cvec *cv = axv_cvecNew(NULL);
+    CHECK(cv && axv_cvecLen(cv) == 0 && !axv_cvecGet(cv, 0));
+    static const uint64_t runs[] = {63, 1, 127, 2, 1, 190, 0, 3, 447 - 387, 1, 1, N - 449};
+    uint64_t len = 0;
+    for (uint64_t r = 0; r < sizeof runs / sizeof *runs; ++r) {
+        for (uint64_t i = 0; i < runs[r]; ++i)
+            ref[len + i] = item(len + i + 1);
+        if (runs[r] == 1)
+            CHECK(!axv_cvecPush(cv, ref[len]));
+        else
+            CHECK(!axv_cvecPushN(cv, ref + len, runs[r]));
+        len += runs[r];
+        CHECK(axv_cvecLen(cv) == len && !axv_cvecGet(cv, len));
+    }
+    CHECK(len == N);
+    bool same = true;
+    for (uint64_t i = 0; i < N; ++i)
+        same &= axv_cvecGet(cv, i) == ref[i];
+    CHECK(same && axv_cvecGet(cv, 63) == item(64) && axv_cvecGet(cv, 64) == item(65));
+    CHECK(axv_cvecGet(cv, 191) == item(192) && axv_cvecGet(cv, 192) == item(193));
+    axvector *v = axv_cvecFreeze(cv);
+    CHECK(v && equals(v, ref, N));
+    axv_destroy(v);
+
+    // freezing at exactly a segment boundary, and freezing an empty vector
+    static const uint64_t lens[] = {0, 63, 64, 65, 191, 192, 193};
+    for (uint64_t l = 0; l < sizeof lens / sizeof *lens; ++l) {
+        cv = axv_cvecNew(NULL);
+        for (uint64_t i = 0; i < lens[l]; ++i)
+            axv_cvecPush(cv, ref[i]);
+        v = axv_cvecFreeze(cv);
+        CHECK(v && equals(v, ref, lens[l]) && !axv_push(v, NULL) && axv_ulen(v) == lens[l] + 1);
+        axv_destroy(v);
+    }
+
+    // runs pushed by several threads at once stay together, and none is lost
+    cv = axv_cvecNew(NULL);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i)
+        pthread_create(threads + i, NULL, pushRuns, cv);
+    bool failed = false;
+    for (int i = 0; i < 4; ++i) {
+        void *result;
+        pthread_join(threads[i], &result);
+        failed |= result != NULL;
+    }
+    uint64_t expected = 0;
+    for (uint64_t r = 0; r < CVEC_RUNS; ++r)
+        expected += 4 * (1 + r % 8);
+    CHECK(!failed && axv_cvecLen(cv) == expected);
+    v = axv_cvecFreeze(cv);
+    CHECK(v && axv_ulen(v) == expected);
+    uint64_t next[4] = {0, 0, 0, 0};
+    same = true;
+    for (uint64_t i = 0; v && i < expected;) {
+        const uint64_t x = (uintptr_t) axv_get(v, i), id = x >> 40, r = x >> 8 & 0xffffffff;
+        same &= id < 4 && r == next[id & 3] && (x & 0xff) == 0;
+        const uint64_t n = 1 + r % 8;
+        for (uint64_t j = 0; j < n; ++j)
+            same &= (uintptr_t) axv_get(v, i + j) == (id << 40 | r << 8 | j);
+        ++next[id & 3];
+        i += n;
+    }
+    CHECK(same && next[0] == CVEC_RUNS && next[1] == CVEC_RUNS && next[2] == CVEC_RUNS && next[3] == CVEC_RUNS);
+    axv_destroy(v);
+
+    // slots whose segment could not be allocated read as NULL, also once a later push allocates the segment
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    cv = axv_cvecNew(&allocator);
+    CHECK(!axv_cvecPushN(cv, ref, 64));
+    arena.budget = 0;
+    CHECK(axv_cvecPush(cv, ref[64]) && axv_cvecPushN(cv, ref + 65, 3) && axv_cvecLen(cv) == 68);
+    CHECK(!axv_cvecGet(cv, 64) && !axv_cvecGet(cv, 67) && axv_cvecGet(cv, 63) == ref[63]);
+    arena.budget = UINT64_MAX;
+    CHECK(!axv_cvecPushN(cv, ref + 68, 200) && axv_cvecLen(cv) == 268);
+    same = true;
+    for (uint64_t i = 64; i < 68; ++i)
+        same &= !axv_cvecGet(cv, i);
+    for (uint64_t i = 68; i < 268; ++i)
+        same &= axv_cvecGet(cv, i) == ref[i];
+    CHECK(same);
+    v = axv_cvecFreeze(cv);
+    CHECK(v && axv_ulen(v) == 268 && axv_get(v, 63) == ref[63] && axv_get(v, 68) == ref[68]);
+    for (uint64_t i = 64; v && i < 68; ++i)
+        CHECK(!axv_get(v, i));
+    axv_destroy(v);
+    CHECK(arena.live == 0 && arena.badSizes == 0 && arena.frees == arena.allocs);
+    arena.budget = 1;
+    CHECK(!axv_cvecNew(&allocator) && arena.live == 0);
+}
+
+
+// sorts a copy of v with qsort and returns it
+static axvector *sortedCopy(axvector *v, int (*cmp)(const void *, const void *)) {
+    axvector *ref = axv_copy(v);
+    qsort(axv_data(ref), axv_ulen(ref), sizeof(void *), cmp);
+    return ref;
+}
+
+
+static void testStableSort(void) {
+    // items carry a key in their high bits and their position in the low bits, and sorting by the key alone must
+    // give the same order as sorting by both
+    for (int shape = 0; shape < 5; ++shape) {
+        for (uint64_t n = 0; n < 6000; n = n * 3 + 1) {
+            axvector *v = axv_new();
+            for (uint64_t i = 0; i < n; ++i) {
+                // random with duplicates, ascending with a few outliers, descending in equal pairs, all equal, and
+                // alternating ascending and descending runs
+                const uint64_t k = shape == 0 ? rng() % (n / 4 + 1)
+                                 : shape == 1 ? i / 3 + (i % 100 == 0) * 50
+                                 : shape == 2 ? (n - i) / 2
+                                 : shape == 3 ? 7
+                                 : i / 100 % 2 ? i % 100 : 100 - i % 100;
+                axv_push(v, item(k << 16 | i));
+            }
+            axv_setComparator(v, compareHigh);
+            axvector *ref = sortedCopy(v, axv_compareAddress);
+            CHECK(!axv_stableSort(v) && equals(v, axv_data(ref), n));
+            axv_destroy(ref);
+            axv_destroy(v);
+        }
+    }
+
+    // the k least items come first in order, and the rest are the remaining items
+    for (uint64_t n = 0; n < 3000; n = n * 4 + 3) {
+        axvector *v = randomVector(n, n / 3 + 1);
+        axvector *ref = sortedCopy(v, axv_compareAddress);
+        const uint64_t ks[] = {0, 1, 2, n / 10, n / 2, n - 1, n, n + 5};
+        for (uint64_t j = 0; j < sizeof ks / sizeof *ks; ++j) {
+            axvector *w = axv_copy(v);
+            const uint64_t k = ks[j] < n ? ks[j] : n;
+            CHECK(axv_partialSort(w, ks[j]) == w && axv_ulen(w) == n);
+            CHECK(k == 0 || memcmp(axv_data(w), axv_data(ref), k * sizeof(void *)) == 0);
+            CHECK(equals(axv_sort(w), axv_data(ref), n));
+            axv_destroy(w);
+        }
+
+        // nthElement puts the sorted item at the index and partitions the others around it
+        const int64_t len = (int64_t) n, indices[] = {0, 1, len / 2, len - 1, -1, -len, len, -len - 1};
+        for (uint64_t j = 0; j < sizeof indices / sizeof *indices; ++j) {
+            axvector *w = axv_copy(v);
+            const int64_t index = indices[j], i = index + (index < 0) * len;
+            if (i < 0 || i >= len) {
+                CHECK(axv_nthElement(w, index) && equals(w, axv_data(v), n));
+            } else {
+                CHECK(!axv_nthElement(w, index) && axv_get(w, i) == axv_get(ref, i));
+                bool partitioned = true;
+                const uintptr_t nth = (uintptr_t) axv_get(w, i);
+                for (int64_t m = 0; m < len; ++m)
+                    partitioned &= m < i ? (uintptr_t) axv_get(w, m) <= nth : (uintptr_t) axv_get(w, m) >= nth;
+                CHECK(partitioned && equals(axv_sort(w), axv_data(ref), n));
+            }
+            axv_destroy(w);
+        }
+        axv_destroy(ref);
+        axv_destroy(v);
+    }
+}
+
+
+// a random vector sorted by compareHigh, whose items have a key below range in their high bits and a distinct tag
+static axvector *sortedKeys(uint64_t n, uint64_t range, uint64_t tag) {
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < n; ++i)
+        axv_push(v, item((rng() % range) << 16 | (tag + i)));
+    axv_setComparator(v, compareHigh);
+    axv_stableSort(v);
+    return v;
+}
+
+
+static void testSortedOps(void) {
+    // the bounds agree with a scan for every key, present or not, before, within and after the items
+    for (uint64_t n = 0; n < 2000; n = n * 3 + 1) {
+        axvector *v = sortedKeys(n, n / 3 + 2, 0);
+        bool same = true;
+        for (uint64_t key = 0; key < n / 3 + 4; ++key) {
+            void *val = item(key << 16 | 0xffff);
+            int64_t lower = 0, upper = 0;
+            while (lower < axv_len(v) && (uintptr_t) axv_get(v, lower) >> 16 < key)
+                ++lower;
+            while (upper < axv_len(v) && (uintptr_t) axv_get(v, upper) >> 16 <= key)
+                ++upper;
+            same &= axv_lowerBound(v, val) == lower && axv_upperBound(v, val) == upper;
+        }
+        CHECK(same);
+        axv_destroy(v);
+    }
+
+    // inserting goes after the equal items and removing takes the first one, like on an array shifted by hand
+    enum {N = 1500};
+    static void *ref[N];
+    uint64_t len = 0;
+    axvector *v = axv_new();
+    axv_setComparator(v, compareHigh);
+    axv_setDestructor(v, countDestroyed);
+    destroyed = 0;
+    uint64_t removed = 0;
+    bool same = true;
+    for (uint64_t round = 0; round < 4 * N; ++round) {
+        void *val = item((rng() % 200) << 16 | round % 0xffff);
+        uint64_t i = 0;
+        while (i < len && compareHigh(ref + i, &val) < 0)
+            ++i;
+        const bool present = i < len && compareHigh(ref + i, &val) == 0;
+        if (rng() % 3 != 0 && len < N) {
+            i = len;
+            while (i > 0 && compareHigh(ref + i - 1, &val) > 0)
+                --i;
+            memmove(ref + i + 1, ref + i, (len++ - i) * sizeof(void *));
+            ref[i] = val;
+            same &= !axv_insertSorted(v, val);
+        } else {
+            same &= axv_removeSorted(v, val) == !present;
+            removed += present;
+            if (present)
+                memmove(ref + i, ref + i + 1, (--len - i) * sizeof(void *));
+        }
+        same &= axv_ulen(v) == len;
+    }
+    CHECK(same && equals(v, ref, len) && destroyed == removed);
+    axv_setDestructor(v, NULL);
+    axv_destroy(v);
+
+    uint64_t inserted = 0;
+    v = axv_new();
+    axv_setComparator(v, compareHigh);
+    axv_setDestructor(v, countDestroyed);
+    destroyed = 0;
+    for (uint64_t i = 0; i < 100; ++i)
+        inserted += !axv_insertSorted(v, item((i % 10) << 16 | i));
+    CHECK(axv_removeSorted(v, item(10 << 16)) && destroyed == 0);
+    for (uint64_t i = 0; i < 30; ++i)
+        CHECK(!axv_removeSorted(v, item((i % 10) << 16)));
+    CHECK(inserted == 100 && axv_ulen(v) == 70 && destroyed == 30);
+    for (uint64_t i = 0; i < 70; ++i)
+        CHECK(axv_get(v, i) == item((i / 7) << 16 | ((i % 7 + 3) * 10 + i / 7)));
+    axv_setDestructor(v, NULL);
+    axv_destroy(v);
+
+    // merging is stable with the items of the first vector first, and a vector merged into itself doubles each item
+    for (uint64_t n1 = 0; n1 < 1500; n1 = n1 * 5 + 2) {
+        for (uint64_t n2 = 0; n2 < 1500; n2 = n2 * 5 + 3) {
+            axvector *v1 = sortedKeys(n1, 50, 0), *v2 = sortedKeys(n2, 50, 0x8000);
+            void **merged = malloc((n1 + 2 * n2 + 1) * sizeof(void *));
+            uint64_t i = 0, j = 0, k = 0;
+            while (i < n1 || j < n2) {
+                if (j == n2 || (i < n1 && compareHigh(axv_data(v1) + i, axv_data(v2) + j) <= 0))
+                    merged[k++] = axv_get(v1, i++);
+                else
+                    merged[k++] = axv_get(v2, j++);
+            }
+            axvector *copy2 = axv_copy(v2);
+            CHECK(!axv_mergeSorted(v1, v2) && equals(v1, merged, n1 + n2) && equals(v2, axv_data(copy2), n2));
+            for (i = 0; i < n2; ++i)
+                merged[2 * i] = merged[2 * i + 1] = axv_get(v2, i);
+            CHECK(!axv_mergeSorted(v2, v2) && equals(v2, merged, 2 * n2));
+            axv_destroy(copy2);
+            free(merged);
+            axv_destroy(v1);
+            axv_destroy(v2);
+        }
+    }
+
+    // running out of memory leaves the first vector as it was
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    axvector *v1 = axv_newWithAllocator(0, &allocator), *v2 = sortedKeys(100, 10, 0);
+    for (uint64_t i = 0; i < 10; ++i)
+        axv_push(v1, item(i << 16));
+    axv_setComparator(v1, compareHigh);
+    arena.budget = 0;
+    CHECK(axv_mergeSorted(v1, v2) && axv_ulen(v1) == 10 && axv_get(v1, 9) == item(9 << 16));
+    axv_destroy(v1);
+    axv_destroy(v2);
+    CHECK(arena.live == 0);
+}
+
+
+static uint64_t hashHigh(const void *x) {
+    return (uintptr_t) x >> 16;
+}
+
+
+// first index of an item comparing equal to val by its high bits
+static int64_t scanHigh(axvector *v, void *val) {
+    for (uint64_t i = 0; i < axv_ulen(v); ++i) {
+        if (compareHigh(axv_data(v) + i, &val) == 0)
+            return (int64_t) i;
+    }
+    return -1;
+}
+
+
+static void testIndex(void) {
+    // the index follows the inline updates and is rebuilt after everything else, answering like a scan
+    axvector *v = axv_new();
+    axv_setHash(v, axv_hashAddress);
+    bool same = true;
+    for (int i = 0; i < 20000; ++i) {
+        void *x = item(rng() % 64 + 1);
+        switch (rng() % 12) {
+        case 0: case 1: axv_push(v, x); break;
+        case 2: case 3: axv_pushFront(v, x); break;
+        case 4: axv_pop(v); break;
+        case 5: axv_popFront(v); break;
+        case 6: case 7: if (axv_ulen(v)) axv_set(v, (int64_t) (rng() % axv_ulen(v)), x); break;
+        case 8: axv_rotate(v, 3); break;
+        case 9: axv_shift(v, (int64_t) (rng() % (axv_ulen(v) + 1)), (int64_t) (rng() % 5) - 2); break;
+        case 10: axv_reverse(v); break;
+        default: if (rng() % 8 == 0) axv_clear(v); break;
+        }
+        void *probe = item(rng() % 64 + 1);
+        same &= axv_linearSearch(v, probe) == scan(v, probe) && axv_count(v, probe) == countScan(v, probe);
+    }
+    CHECK(same);
+
+    // dropping the hash function falls back to scanning
+    axv_setHash(v, NULL);
+    for (uint64_t x = 0; x < 70; ++x)
+        CHECK(axv_linearSearch(v, item(x)) == scan(v, item(x)) && axv_count(v, item(x)) == countScan(v, item(x)));
+    axv_destroy(v);
+
+    // a hash consistent with another comparator finds the first item equal to the probe, not the same item
+    v = axv_new();
+    axv_setComparator(v, compareHigh);
+    axv_setHash(v, hashHigh);
+    for (uint64_t i = 0; i < 3000; ++i)
+        axv_push(v, item((rng() % 300) << 16 | i));
+    same = true;
+    for (uint64_t key = 0; key < 310; ++key) {
+        void *probe = item(key << 16 | 0xffff);
+        uint64_t n = 0;
+        for (uint64_t i = 0; i < axv_ulen(v); ++i)
+            n += compareHigh(axv_data(v) + i, &probe) == 0;
+        same &= axv_linearSearch(v, probe) == scanHigh(v, probe) && axv_count(v, probe) == n;
+    }
+    CHECK(same);
+
+    // dedupe keeps the first of each key in order, like a quadratic loop over the items
+    void **ref = malloc(axv_ulen(v) * sizeof(void *));
+    uint64_t len = 0;
+    for (uint64_t i = 0; i < axv_ulen(v); ++i) {
+        uint64_t j = 0;
+        while (j < len && compareHigh(ref + j, axv_data(v) + i) != 0)
+            ++j;
+        if (j == len)
+            ref[len++] = axv_get(v, i);
+    }
+    axv_setDestructor(v, countDestroyed);
+    destroyed = 0;
+    CHECK(!axv_dedupe(v) && equals(v, ref, len) && destroyed == 3000 - len);
+    for (uint64_t i = 0; i < len; ++i)
+        CHECK(axv_linearSearch(v, ref[i]) == (int64_t) i && axv_count(v, ref[i]) == 1);
+    axv_setDestructor(v, NULL);
+
+    // without a hash function, dedupe only works with the default comparator
+    axv_setHash(v, NULL);
+    CHECK(axv_dedupe(v) && equals(v, ref, len));
+    axv_setComparator(v, NULL);
+    for (uint64_t i = 0; i < 100; ++i)
+        axv_push(v, ref[i % 10]);
+    CHECK(!axv_dedupe(v) && equals(v, ref, len));
+    free(ref);
+    axv_destroy(v);
+}
+
+
+static uint64_t comparisons;
+
+
+static int compareHighCounted(const void *a, const void *b) {
+    ++comparisons;
+    return compareHigh(a, b);
+}
+
+
+// the set operations done one item at a time, with op 0 intersect, 1 union and 2 difference
+static uint64_t combineLoop(axvector *v1, axvector *v2, int op, void **out) {
+    const uint64_t n1 = axv_ulen(v1), n2 = axv_ulen(v2);
+    void **a = axv_data(v1), **b = axv_data(v2);
+    uint64_t i = 0, j = 0, n = 0;
+    while (i < n1 || j < n2) {
+        const int c = i == n1 ? 1 : j == n2 ? -1 : compareHigh(a + i, b + j);
+        if (c < 0) {
+            if (op != 0)
+                out[n++] = a[i];
+            ++i;
+        } else if (c > 0) {
+            if (op == 1)
+                out[n++] = b[j];
+            ++j;
+        } else {
+            if (op != 2)
+                out[n++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return n;
+}
+
+
+static void testSetAlgebra(void) {
+    // few and many duplicates, overlapping and disjoint key ranges, and lengths far apart for the galloping
+    static const uint64_t lens[][2] = {{0, 0}, {0, 10}, {10, 0}, {1, 1}, {50, 50}, {300, 200}, {5, 5000},
+                                       {5000, 5}, {1, 4000}, {2000, 2000}};
+    for (uint64_t l = 0; l < sizeof lens / sizeof *lens; ++l) {
+        for (int ranges = 0; ranges < 3; ++ranges) {
+            const uint64_t n1 = lens[l][0], n2 = lens[l][1];
+            const uint64_t range = ranges == 0 ? 10 : ranges == 1 ? (n1 + n2) / 2 + 1 : 100000;
+            axvector *v1 = sortedKeys(n1, range, 0), *v2 = sortedKeys(n2, range, 0x8000);
+            if (ranges == 2 && l % 2) {
+                // every key of the second vector above those of the first
+                for (uint64_t i = 0; i < n2; ++i)
+                    axv_set(v2, (int64_t) i, item((uintptr_t) axv_get(v2, i) + (UINT64_C(100000) << 16)));
+            }
+            void **ref = malloc((n1 + n2 + 1) * sizeof(void *));
+            axvector *(*const ops[])(axvector *, axvector *) = {axv_intersect, axv_union, axv_difference};
+            for (int op = 0; op < 3; ++op) {
+                const uint64_t n = combineLoop(v1, v2, op, ref);
+                axvector *v = ops[op](v1, v2);
+                CHECK(v && equals(v, ref, n) && axv_getComparator(v) == compareHigh);
+                axv_destroy(v);
+            }
+            free(ref);
+            axv_destroy(v1);
+            axv_destroy(v2);
+        }
+    }
+
+    // the short vector gallops through the long one in far fewer comparisons than a merge would make
+    axvector *shortv = sortedKeys(10, 1000000, 0), *longv = sortedKeys(100000, 1000000, 0x8000);
+    axv_setComparator(shortv, compareHighCounted);
+    void **ref = malloc(100011 * sizeof(void *));
+    for (int op = 0; op < 3; ++op) {
+        comparisons = 0;
+        axvector *v = op == 0 ? axv_intersect(shortv, longv) : op == 1 ? axv_union(longv, shortv)
+                    : axv_difference(shortv, longv);
+        CHECK(v && (op == 1 || comparisons < 1000));
+        CHECK(equals(v, ref, op == 1 ? combineLoop(longv, shortv, 1, ref) : combineLoop(shortv, longv, op, ref)));
+        axv_destroy(v);
+    }
+    free(ref);
+    axv_destroy(shortv);
+    axv_destroy(longv);
+
+    // unique keeps the first of every run, like a loop comparing each item with the last one kept
+    for (uint64_t n = 0; n < 3000; n = n * 3 + 1) {
+        axvector *v = sortedKeys(n, n / 4 + 1, 0);
+        void **kept = malloc((n + 1) * sizeof(void *));
+        uint64_t len = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            if (len == 0 || compareHigh(kept + len - 1, axv_data(v) + i) != 0)
+                kept[len++] = axv_get(v, i);
+        }
+        axv_setDestructor(v, countDestroyed);
+        destroyed = 0;
+        CHECK(axv_unique(v) == v && equals(v, kept, len) && destroyed == n - len);
+        axv_setDestructor(v, NULL);
+        free(kept);
+        axv_destroy(v);
+    }
+}
+
+
+// applies a scalar predicate to each block, recording how the items were handed over
+typedef struct {
+    bool (*pred)(const void *, void *);
+    void **next;
+    uint64_t blocks;
+    uint64_t items;
+    bool contiguous;
+} batchLog;
+
+
+static void predicateBatch(void **items, uint64_t n, bool *result, void *arg) {
+    batchLog *log = arg;
+    log->contiguous &= n > 0 && n <= AXV_BATCH && (!log->next || items == log->next);
+    log->next = items + n;
+    ++log->blocks;
+    log->items += n;
+    for (uint64_t i = 0; i < n; ++i)
+        result[i] = log->pred(items[i], NULL);
+}
+
+
+static void addOneBatch(void **items, uint64_t n, void *arg) {
+    ++*(uint64_t *) arg;
+    for (uint64_t i = 0; i < n; ++i)
+        items[i] = addOne(items[i], NULL);
+}
+
+
+static bool sumUntilBatch(void **items, uint64_t n, void *arg) {
+    uint64_t *state = arg;
+    for (uint64_t i = 0; i < n; ++i)
+        state[0] += (uintptr_t) items[i];
+    ++state[1];
+    return state[0] < state[2];
+}
+
+
+static bool sumUntil(void *x, void *arg) {
+    uint64_t *state = arg;
+    state[0] += (uintptr_t) x;
+    return state[0] < state[2];
+}
+
+
+static void testBatchCallbacks(void) {
+    static const uint64_t lens[] = {0, 1, AXV_BATCH - 1, AXV_BATCH, AXV_BATCH + 1, 2 * AXV_BATCH + 1, 1000};
+    bool (*const preds[])(const void *, void *) = {isEven, isMultipleOf10, isZero};
+    for (uint64_t l = 0; l < sizeof lens / sizeof *lens; ++l) {
+        const uint64_t n = lens[l];
+        for (int p = 0; p < 3; ++p) {
+            axvector *v = randomVector(n, 100);
+            if (p == 2 && n > 0)
+                axv_set(v, (int64_t) (rng() % n), NULL);
+
+            // filter and partition keep and reject the same items as their scalar versions
+            axvector *ref = axv_copy(v), *batch = axv_copy(v);
+            axv_setDestructor(batch, countDestroyed);
+            destroyed = 0;
+            batchLog log = {preds[p], NULL, 0, 0, true};
+            CHECK(axv_filter(ref, preds[p], NULL) == ref && axv_filterBatch(batch, predicateBatch, &log) == batch);
+            CHECK(equals(batch, axv_data(ref), axv_ulen(ref)) && destroyed == n - axv_ulen(ref));
+            CHECK(log.contiguous && log.items == n && log.blocks == (n + AXV_BATCH - 1) / AXV_BATCH);
+            axv_setDestructor(batch, NULL);
+            axv_destroy(ref);
+            axv_destroy(batch);
+            ref = axv_copy(v);
+            batch = axv_copy(v);
+            log = (batchLog) {preds[p], NULL, 0, 0, true};
+            axvector *rejected = axv_partition(ref, preds[p], NULL);
+            axvector *rejectedBatch = axv_partitionBatch(batch, predicateBatch, &log);
+            CHECK(rejected && rejectedBatch && equals(batch, axv_data(ref), axv_ulen(ref)));
+            CHECK(equals(rejectedBatch, axv_data(rejected), axv_ulen(rejected)) && log.contiguous);
+            axv_destroy(rejected);
+            axv_destroy(rejectedBatch);
+            axv_destroy(ref);
+            axv_destroy(batch);
+
+            // any and all agree, and stop after the first block deciding the answer
+            uint64_t first = n, firstNot = n;
+            for (uint64_t i = n; i-- > 0;) {
+                if (preds[p](axv_get(v, i), NULL))
+                    first = i;
+                else
+                    firstNot = i;
+            }
+            log = (batchLog) {preds[p], NULL, 0, 0, true};
+            CHECK(axv_anyBatch(v, predicateBatch, &log) == axv_any(v, preds[p], NULL) && log.contiguous);
+            CHECK(log.blocks == (first < n ? first / AXV_BATCH + 1 : (n + AXV_BATCH - 1) / AXV_BATCH));
+            log = (batchLog) {preds[p], NULL, 0, 0, true};
+            CHECK(axv_allBatch(v, predicateBatch, &log) == axv_all(v, preds[p], NULL) && log.contiguous);
+            CHECK(log.blocks == (firstNot < n ? firstNot / AXV_BATCH + 1 : (n + AXV_BATCH - 1) / AXV_BATCH));
+            axv_destroy(v);
+        }
+
+        // map hands over all items at once, and foreach stops after the block in which f returns false
+        axvector *v = randomVector(n, 1000);
+        axvector *ref = axv_map(axv_copy(v), addOne, NULL);
+        uint64_t calls = 0;
+        CHECK(axv_mapBatch(v, addOneBatch, &calls) == v && equals(v, axv_data(ref), n) && calls == (n > 0));
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < n; ++i)
+            total += (uintptr_t) axv_get(v, i);
+        const uint64_t limits[] = {0, 1, total / 2, total, total + 1};
+        for (uint64_t j = 0; j < 5; ++j) {
+            uint64_t state[3] = {0, 0, limits[j]}, scalar[3] = {0, 0, limits[j]};
+            axv_foreach(v, sumUntil, scalar);
+            uint64_t blocks = 0, sum = 0;
+            for (uint64_t i = 0; i < n; i += AXV_BATCH) {
+                ++blocks;
+                for (uint64_t k = i; k < n && k < i + AXV_BATCH; ++k)
+                    sum += (uintptr_t) axv_get(v, k);
+                if (sum >= limits[j])
+                    break;
+            }
+            CHECK(axv_foreachBatch(v, sumUntilBatch, state) == v && state[0] == sum && state[1] == blocks);
+            CHECK(state[0] >= scalar[0] && (blocks == 0 || sum - scalar[0] < AXV_BATCH * 1001));
+        }
+        axv_destroy(ref);
+        axv_destroy(v);
+    }
+}
+
+
+static void *pushThousand(void *arg) {
+    (void) arg;
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < 1000; ++i)
+        axv_push(v, item(i));
+    axv_destroy(v);
+    return NULL;
+}
+
+
+static void testStats(void) {
+    axv_stats(true);
+    axvector *v = axv_new();
+    for (uint64_t i = 0; i < 20; ++i)
+        axv_push(v, item(i));
+    // 7 inline slots grow to 15 on the heap, then realloc to 31
+    axv_statistics s = axv_stats(false);
+#ifdef AXV_STATS
+    CHECK(s.resizes == 2 && s.reallocBytes == (7 + 15) * sizeof(void *) && s.maxCapacity == 31);
+    CHECK(s.movedBytes == 0 && s.comparisons == 0 && s.destructions == 0);
+#endif
+
+    // moving the items behind a section counts them, removing the front only advances the items
+    axv_setDestructor(v, countDestroyed);
+    CHECK(!axv_shift(v, 10, -5) && !axv_shift(v, 0, -2) && axv_ulen(v) == 13);
+    axvector *copy = axv_copy(v);
+    s = axv_stats(true);
+#ifdef AXV_STATS
+    CHECK(s.movedBytes == (5 + 13) * sizeof(void *) && s.destructions == 7 && s.resizes == 2);
+#endif
+    axv_setDestructor(v, NULL);
+
+    // comparisons are the calls a counting comparator sees, and the default comparator is not called at all
+    axv_setComparator(copy, compareHighCounted);
+    comparisons = 0;
+    axv_sort(copy);
+    CHECK(axv_linearSearch(copy, item(5)) == 0 && axv_count(copy, item(5)) == 13);
+    CHECK(axv_linearSearch(v, item(12)) == -1 && axv_count(v, item(2)) == 1);
+    s = axv_stats(true);
+#ifdef AXV_STATS
+    CHECK(s.comparisons == comparisons && comparisons > 13 && s.resizes == 0 && s.movedBytes == 0);
+#endif
+
+    // vectors on several threads add up exactly
+    pthread_t threads[4];
+    pushThousand(NULL);
+    const axv_statistics one = axv_stats(true);
+    for (int i = 0; i < 4; ++i)
+        pthread_create(threads + i, NULL, pushThousand, NULL);
+    for (int i = 0; i < 4; ++i)
+        pthread_join(threads[i], NULL);
+    s = axv_stats(true);
+#ifdef AXV_STATS
+    CHECK(one.resizes == 7 && s.resizes == 4 * one.resizes && s.reallocBytes == 4 * one.reallocBytes);
+    CHECK(s.maxCapacity == one.maxCapacity && one.maxCapacity == 1023);
+#endif
+
+    // resizing a shared vector is a single resize
+    axvector *snapshot = axv_snapshot(copy);
+    axv_stats(true);
+    CHECK(!axv_resize(snapshot, 100) && axv_ucap(snapshot) == 100);
+    s = axv_stats(true);
+    axv_destroy(snapshot);
+#ifdef AXV_STATS
+    CHECK(s.resizes == 1 && s.maxCapacity == 100 && s.movedBytes == 13 * sizeof(void *) && s.reallocBytes == 0);
+#endif
+
+    // the destructions of axvparallel are counted
+    axv_setDestructor(v, countDestroyed);
+    destroyed = 0;
+    CHECK(axv_pfilter(v, isEven, NULL) == v);
+    s = axv_stats(true);
+#ifdef AXV_STATS
+    CHECK(s.destructions == destroyed && destroyed > 0);
+#else
+    // without AXV_STATS, nothing is counted
+    CHECK(one.resizes == 0 && one.maxCapacity == 0);
+    CHECK(s.resizes == 0 && s.reallocBytes == 0 && s.movedBytes == 0 && s.comparisons == 0 && s.destructions == 0);
+    CHECK(s.maxCapacity == 0);
+#endif
+    axv_setDestructor(v, NULL);
+    axv_destroy(copy);
+    axv_destroy(v);
+}
+
+
+static bool isBelow(const void *x, void *arg) {
+    return (uintptr_t) x < *(uint64_t *) arg;
+}
+
+
+static void testShrink(void) {
+    // the capacity follows a model of doubling on push and halving to twice the length below a quarter full
+    axvector *v = axv_new();
+    axv_setAutoShrink(v, true);
+    uint64_t len = 0, cap = 7;
+    bool same = true;
+    for (uint64_t round = 0; round < 20000; ++round) {
+        const uint64_t phase = round / 2000 % 2;
+        const uint64_t op = rng() % 16;
+        if (op < (phase ? 10u : 5u)) {
+            same &= !axv_push(v, item(len));
+            cap = len >= cap ? 2 * cap + 1 : cap;
+            ++len;
+        } else {
+            uint64_t n = 1;
+            if (op < 12) {
+                axv_pop(v);
+            } else if (op < 14) {
+                n = rng() % 20;
+                axv_discard(v, n);
+            } else if (op < 15) {
+                // the items are their own indices, so keeping those below a threshold removes the last n
+                n = rng() % 10;
+                uint64_t threshold = len > n ? len - n : 0;
+                axv_filter(v, isBelow, &threshold);
+            } else {
+                n = len;
+                axv_clear(v);
+            }
+            len -= n < len ? n : len;
+            if (len < cap / 4 && cap > AXV_INLINE_CAP)
+                cap = 2 * len > AXV_INLINE_CAP ? 2 * len : AXV_INLINE_CAP;
+        }
+        same &= axv_ulen(v) == len && axv_ucap(v) == cap && (len == 0 || axv_get(v, len - 1) == item(len - 1));
+    }
+    CHECK(same);
+    axv_destroy(v);
+
+    // a length oscillating between the thresholds does not resize, however often it crosses back and forth
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    v = axv_newWithAllocator(1000, &allocator);
+    axv_setAutoShrink(v, true);
+    for (uint64_t i = 0; i < 1000; ++i)
+        axv_push(v, item(i));
+    axv_discard(v, 800);
+    CHECK(axv_ucap(v) == 400);
+    const uint64_t before = arena.allocs, live = arena.live;
+    for (uint64_t r = 0; r < 100; ++r) {
+        while (axv_ulen(v) < 400)
+            axv_push(v, item(axv_ulen(v)));
+        while (axv_ulen(v) > 100)
+            axv_pop(v);
+    }
+    CHECK(arena.allocs == before && arena.live == live && axv_ucap(v) == 400);
+    axv_pop(v);
+    CHECK(axv_ucap(v) == 198 && arena.live < live);
+
+    // locked vectors never shrink, and without the policy nothing shrinks
+    axv_lock(v, true);
+    axv_discard(v, 90);
+    CHECK(axv_ucap(v) == 198 && axv_isLocked(v));
+    axv_lock(v, false);
+    axv_setAutoShrink(v, false);
+    axv_clear(v);
+    CHECK(axv_ucap(v) == 198);
+    axv_destroy(v);
+    CHECK(arena.live == 0 && arena.badSizes == 0);
+
+    // shrink-to-fit gives back spare capacity and front slack but keeps the items
+    v = axv_new();
+    for (uint64_t i = 0; i < 1000; ++i)
+        axv_push(v, item(i));
+    for (uint64_t i = 0; i < 600; ++i)
+        axv_popFront(v);
+    CHECK(!axv_shrinkToFit(v) && axv_ucap(v) == 400 && axv_ulen(v) == 400);
+    for (uint64_t i = 0; i < 400; ++i)
+        CHECK(axv_get(v, i) == item(600 + i));
+    axv_discard(v, 397);
+    CHECK(!axv_shrinkToFit(v) && axv_ucap(v) == 3 && isInline(v) && axv_get(v, 2) == item(602));
+    axv_clear(v);
+    CHECK(!axv_shrinkToFit(v) && axv_ucap(v) == 1);
+    axv_lock(v, true);
+    CHECK(axv_shrinkToFit(v));
+    axv_lock(v, false);
+    axv_destroy(v);
+    void *storage[16];
+    axvector overlay = axv_newOverlay(storage, 2, 16);
+    CHECK(!axv_shrinkToFit(&overlay) && axv_ucap(&overlay) == 16 && axv_data(&overlay) == storage);
+}
+
+
+static size_t largestRequest;
+
+
+static void *mallocLargest(size_t size) {
+    largestRequest = size > largestRequest ? size : largestRequest;
+    return malloc(size);
+}
+
+
+static void *reallocLargest(void *ptr, size_t size) {
+    largestRequest = size > largestRequest ? size : largestRequest;
+    return realloc(ptr, size);
+}
+
+
+// whether the items of v are 0, 1, 2 etc. up to n, checking every stride-th of them
+static bool isCounting(axvector *v, uint64_t n, uint64_t stride) {
+    if (axv_ulen(v) != n)
+        return false;
+    for (uint64_t i = 0; i < n; i += stride) {
+        if (axv_get(v, i) != item(i))
+            return false;
+    }
+    return n == 0 || axv_get(v, n - 1) == item(n - 1);
+}
+
+
+static void testLargeBlocks(void) {
+    const uint64_t threshold = AXV_MMAP_THRESHOLD / sizeof(void *);
+    axv_memoryfn(mallocLargest, reallocLargest, NULL);
+    axvector *v = axv_new();
+    void *run[4096];
+    uint64_t len = 0;
+    largestRequest = 0;
+
+    // growing across the threshold keeps the items, and blocks at or above it never reach the memory functions
+    while (len < threshold - 1000) {
+        for (uint64_t i = 0; i < 4096; ++i)
+            run[i] = item(len + i);
+        CHECK(!axv_pushN(v, run, 4096));
+        len += 4096;
+    }
+    CHECK(largestRequest < AXV_MMAP_THRESHOLD);
+    CHECK(!axv_resize(v, threshold) && axv_ucap(v) == threshold && isCounting(v, len, 997));
+    for (uint64_t i = len; i < threshold; ++i)
+        axv_push(v, item(i));
+    len = threshold;
+    CHECK(axv_ucap(v) == threshold && isCounting(v, len, 1));
+
+    // within the reservation of four times the first mapping, the items do not move
+    void **items = axv_data(v);
+    CHECK(!axv_reserve(v, 3 * threshold) && axv_data(v) == items && isCounting(v, len, 1009));
+    for (uint64_t i = 0; i < 1000; ++i)
+        axv_push(v, item(len++));
+    CHECK(!axv_resize(v, 2 * threshold) && axv_data(v) == items && isCounting(v, len, 1013));
+
+    // beyond it the pages move to a new reservation, and back below the threshold the items are copied to the heap
+    CHECK(!axv_resize(v, 5 * threshold) && isCounting(v, len, 1019));
+    axv_setAutoShrink(v, true);
+    axv_discard(v, len - 1000);
+    len = 1000;
+    CHECK(axv_ucap(v) == 2000 && isCounting(v, len, 1));
+    CHECK(largestRequest < AXV_MMAP_THRESHOLD);
+    axvector *copy = axv_copy(v);
+    CHECK(!axv_resize(copy, threshold + 1) && !axv_resize(copy, threshold - 1) && isCounting(copy, len, 1));
+    CHECK(largestRequest == (threshold - 1) * sizeof(void *));
+    axv_destroy(copy);
+    axv_destroy(v);
+    axv_memoryfn(NULL, NULL, NULL);
+}
+
+
+// writes an item as its bytes flipped, so that a decoder reading them raw would get them wrong
+static bool encodeFlipped(FILE *f, const void *x, void *arg) {
+    (void) arg;
+    const uint64_t bits = ~(uint64_t) (uintptr_t) x;
+    return fwrite(&bits, sizeof bits, 1, f) != 1;
+}
+
+
+// reads an item written by encodeFlipped(), failing once *arg items have been read if arg is given
+static bool decodeFlipped(FILE *f, void **x, void *arg) {
+    uint64_t bits;
+    if ((arg && (*(uint64_t *) arg)-- == 0) || fread(&bits, sizeof bits, 1, f) != 1)
+        return true;
+    *x = item(~bits);
+    return false;
+}
+
+
+// writes n bytes of data to the file at path
+static void writeBytes(const char *path, const void *data, size_t n) {
+    FILE *f = fopen(path, "wb");
+    CHECK(f && fwrite(data, 1, n, f) == n && fclose(f) == 0);
+}
+
+
+static void testSerialize(void) {
+    axvector *v = randomVector(1000, 1000000);
+    FILE *f = tmpfile();
+    CHECK(f && !axv_serialize(v, f, NULL, NULL));
+    rewind(f);
+    axvector *d = axv_deserialize(f, NULL, NULL, NULL, NULL);
+    CHECK(d && axv_compare(v, d));
+    axv_destroy(d);
+
+    // raw items are rejected by a decoder and the other way round
+    rewind(f);
+    CHECK(!axv_deserialize(f, decodeFlipped, NULL, NULL, NULL));
+
+    // the length field follows the magic, byte order mark, item size and encoding flag
+    const uint64_t lengths[] = {(UINT64_C(1) << 61) + 1, 1001, UINT64_MAX};
+    for (int i = 0; i < 3; ++i) {
+        fseek(f, 24, SEEK_SET);
+        fwrite(lengths + i, sizeof *lengths, 1, f);
+        rewind(f);
+        CHECK(!axv_deserialize(f, NULL, NULL, NULL, NULL));
+    }
+    fseek(f, 0, SEEK_SET);
+    fputc('X', f);
+    rewind(f);
+    CHECK(!axv_deserialize(f, NULL, NULL, NULL, NULL));
+    fclose(f);
+
+    // encoded items go through the coders, and a failing decoder leaves nothing behind
+    f = tmpfile();
+    CHECK(f && !axv_serialize(v, f, encodeFlipped, NULL));
+    rewind(f);
+    CHECK(!axv_deserialize(f, NULL, NULL, NULL, NULL));
+    rewind(f);
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    d = axv_deserialize(f, decodeFlipped, NULL, NULL, &allocator);
+    CHECK(d && axv_compare(v, d) && axv_getAllocator(d) == &allocator);
+    axv_destroy(d);
+    uint64_t budget = 600;
+    rewind(f);
+    destroyed = 0;
+    CHECK(!axv_deserialize(f, decodeFlipped, &budget, countDestroyed, &allocator) && destroyed == 600);
+    CHECK(arena.live == 0 && arena.badSizes == 0);
+    fclose(f);
+
+    // a saved file maps back to the same items, also after items are popped off either end
+    char path[] = "/tmp/axvtestXXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(fd >= 0 && close(fd) == 0);
+    CHECK(!axv_saveFile(v, path));
+    axvector mapped;
+    CHECK(!axv_mapFile(&mapped, path) && axv_compare(v, &mapped) && axv_isLocked(&mapped));
+    CHECK(axv_popFront(&mapped) == axv_get(v, 0) && axv_popFront(&mapped) == axv_get(v, 1));
+    CHECK(axv_pop(&mapped) == axv_get(v, 999) && axv_ulen(&mapped) == 997 && axv_get(&mapped, 0) == axv_get(v, 2));
+    axv_setDestructor(&mapped, countDestroyed);
+    destroyed = 0;
+    axv_unmapFile(&mapped);
+    CHECK(destroyed == 997);
+
+    // an empty vector saves and maps, but empty files and truncated or damaged headers do not map
+    axvector *empty = axv_new();
+    CHECK(!axv_saveFile(empty, path) && !axv_mapFile(&mapped, path) && axv_ulen(&mapped) == 0);
+    axv_unmapFile(&mapped);
+    axv_destroy(empty);
+    f = fopen(path, "rb");
+    d = f ? axv_deserialize(f, NULL, NULL, NULL, NULL) : NULL;
+    CHECK(d && axv_ulen(d) == 0);
+    axv_destroy(d);
+    char header[40];
+    CHECK(f && fseek(f, 0, SEEK_SET) == 0 && fread(header, 1, 32, f) == 32 && fclose(f) == 0);
+    for (size_t n = 0; n < 32; n += 7) {
+        writeBytes(path, header, n);
+        CHECK(axv_mapFile(&mapped, path));
+        f = fopen(path, "rb");
+        CHECK(f && !axv_deserialize(f, NULL, NULL, NULL, NULL));
+        fclose(f);
+    }
+    // a length not matching the file size, and trailing bytes that are not a whole item
+    header[24] = 1;
+    writeBytes(path, header, 32);
+    CHECK(axv_mapFile(&mapped, path));
+    header[24] = 0;
+    writeBytes(path, header, 36);
+    CHECK(axv_mapFile(&mapped, path));
+    CHECK(remove(path) == 0 && axv_mapFile(&mapped, path));
+    axv_destroy(v);
+}
+
+
+static void testCursor(void) {
+    // start positions, negative and out of range ones included
+    axvector *v = randomVector(100, 1000);
+    static const int64_t starts[] = {0, 1, 50, 99, 100, 150, -1, -100, -101};
+    for (uint64_t s = 0; s < sizeof starts / sizeof *starts; ++s) {
+        const int64_t i = starts[s] + (starts[s] < 0) * 100;
+        const uint64_t first = i < 0 || i > 100 ? 100 : (uint64_t) i;
+        axv_cursor c = axv_cursorAt(v, starts[s], s % 3 * 4);
+        uint64_t n = 0;
+        void *val;
+        bool same = axv_cursorPos(&c) == first;
+        while (!axv_next(&c, &val))
+            same &= val == axv_get(v, first + n++);
+        CHECK(same && n == 100 - first && axv_cursorPos(&c) == 100 && axv_next(&c, &val));
+    }
+    axv_destroy(v);
+
+    // a cursor paused while the vector changes resumes at its index, as an index into a plain array would
+    enum {M = 20000};
+    static void *ref[M + 1];
+    const uint64_t distances[] = {0, 1, 16, 1 << 20};
+    for (uint64_t d = 0; d < 4; ++d) {
+        v = axv_new();
+        uint64_t len = 0;
+        for (; len < 300; ++len)
+            axv_push(v, ref[len] = item(rng()));
+        axv_cursor c = axv_cursorAt(v, 0, distances[d]);
+        uint64_t pos = 0;
+        bool same = true;
+        for (uint64_t round = 0; round < 3000; ++round) {
+            if (rng() % 2) {
+                void *val;
+                const bool done = axv_next(&c, &val);
+                same &= done == (pos >= len) && (done || val == ref[pos++]);
+            } else {
+                void **block;
+                const uint64_t n = rng() % 40, m = axv_nextBlock(&c, &block, n);
+                same &= m == (pos >= len ? 0 : len - pos < n ? len - pos : n);
+                for (uint64_t i = 0; i < m; ++i)
+                    same &= block[i] == ref[pos++];
+            }
+            same &= axv_cursorPos(&c) == pos;
+            switch (rng() % 6) {
+            case 0:
+                // pushes reallocate the array, which the cursor does not hold on to
+                for (uint64_t n = rng() % 50; n > 0 && len < M; --n)
+                    axv_push(v, ref[len++] = item(rng()));
+                break;
+            case 1:
+                if (len > 0) {
+                    const uint64_t i = rng() % len;
+                    ref[i] = item(rng());
+                    axv_set(v, (int64_t) i, ref[i]);
+                }
+                break;
+            case 2:
+                if (len > 0 && rng() % 4 == 0) {
+                    axv_popFront(v);
+                    memmove(ref, ref + 1, --len * sizeof(void *));
+                }
+                break;
+            case 3:
+                if (len > 5 && rng() % 2) {
+                    axv_discard(v, 5);
+                    len -= 5;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        CHECK(same && equals(v, ref, len));
+        axv_destroy(v);
+    }
+}
+
+
+#define SNAPSHOTS 8
+#define SNAPSHOT_LEN 1000
+
+
+static void rotateLoop(void **items, uint64_t n, int64_t k) {
+    if (n == 0)
+        return;
+    void **tmp = malloc(n * sizeof(void *));
+    const uint64_t shift = (uint64_t) (k % (int64_t) n + (int64_t) n) % n;
+    for (uint64_t i = 0; i < n; ++i)
+        tmp[(i + shift) % n] = items[i];
+    memcpy(items, tmp, n * sizeof(void *));
+    free(tmp);
+}
+
+
+static void testSnapshots(void) {
+    // vectors and snapshots of them change at random, each of them like its own array and none affecting another
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    axvector *v[SNAPSHOTS];
+    void **ref[SNAPSHOTS];
+    uint64_t len[SNAPSHOTS], count = 1;
+    v[0] = axv_newWithAllocator(0, &allocator);
+    ref[0] = malloc((SNAPSHOT_LEN + 8) * sizeof(void *));
+    len[0] = 0;
+    for (; len[0] < 300; ++len[0])
+        axv_push(v[0], ref[0][len[0]] = item(rng() % 1000));
+    bool same = true;
+    for (uint64_t round = 0; round < 6000; ++round) {
+        const uint64_t j = rng() % count, op = rng() % 17;
+        axvector *w = v[j];
+        void **r = ref[j];
+        uint64_t *n = len + j;
+        const uint64_t i = *n ? rng() % *n : 0;
+        void *x = item(rng() % 1000);
+        void *src[4] = {item(1), item(2), item(3), item(4)};
+        switch (op) {
+        case 0:
+            if (count < SNAPSHOTS) {
+                v[count] = axv_snapshot(w);
+                ref[count] = malloc((SNAPSHOT_LEN + 8) * sizeof(void *));
+                memcpy(ref[count], r, *n * sizeof(void *));
+                len[count] = *n;
+                // vectors with their items inline are copied instead
+                same &= v[count] && (axv_isShared(w) || isInline(w)) && axv_getAllocator(v[count]) == &allocator;
+                ++count;
+            } else if (count > 1) {
+                // destroy the vector, moving the last one into its slot
+                axv_destroy(w);
+                free(r);
+                --count;
+                v[j] = v[count];
+                ref[j] = ref[count];
+                len[j] = len[count];
+            }
+            break;
+        case 1: if (*n) { same &= !axv_set(w, (int64_t) i, x); r[i] = x; } break;
+        case 2: if (*n < SNAPSHOT_LEN) { same &= !axv_push(w, x); r[(*n)++] = x; } break;
+        case 3: same &= axv_pop(w) == (*n ? r[--*n] : NULL); break;
+        case 4:
+            if (*n < SNAPSHOT_LEN) {
+                same &= !axv_pushFront(w, x);
+                memmove(r + 1, r, (*n)++ * sizeof(void *));
+                r[0] = x;
+            }
+            break;
+        case 5:
+            same &= axv_popFront(w) == (*n ? r[0] : NULL);
+            if (*n)
+                memmove(r, r + 1, --*n * sizeof(void *));
+            break;
+        case 6:
+            same &= axv_reverse(w) == w;
+            for (uint64_t a = 0, b = *n; a + 1 < b; ++a, --b) {
+                void *t = r[a];
+                r[a] = r[b - 1];
+                r[b - 1] = t;
+            }
+            break;
+        case 7: {
+            const int64_t k = (int64_t) (rng() % 50) - 25;
+            same &= axv_rotate(w, k) == w;
+            rotateLoop(r, *n, k);
+            break;
+        }
+        case 8:
+            same &= axv_sort(w) == w;
+            qsort(r, *n, sizeof(void *), axv_compareAddress);
+            break;
+        case 9: {
+            same &= axv_filter(w, isEven, NULL) == w;
+            uint64_t kept = 0;
+            for (uint64_t a = 0; a < *n; ++a) {
+                if ((uintptr_t) r[a] % 2 == 0)
+                    r[kept++] = r[a];
+            }
+            *n = kept;
+            break;
+        }
+        case 10:
+            if (*n + 2 <= SNAPSHOT_LEN) {
+                same &= !axv_shift(w, (int64_t) i, 2);
+                memmove(r + i + 2, r + i, (*n - i) * sizeof(void *));
+                r[i] = r[i + 1] = NULL;
+                *n += 2;
+            }
+            break;
+        case 11: {
+            const uint64_t m = rng() % 10, end = i + m < *n ? i + m : *n;
+            same &= !axv_eraseRange(w, (int64_t) i, (int64_t) end);
+            memmove(r + i, r + end, (*n - end) * sizeof(void *));
+            *n -= end - i;
+            break;
+        }
+        case 12: {
+            const uint64_t m = rng() % 20, size = *n + m < 10 ? 0 : *n + m - 10 < SNAPSHOT_LEN ? *n + m - 10 : *n;
+            same &= !axv_resize(w, size) && axv_ucap(w) == (size ? size : 1);
+            *n = size < *n ? size : *n;
+            break;
+        }
+        case 13:
+            if (*n + 4 <= SNAPSHOT_LEN) {
+                same &= !axv_pushN(w, src, 4);
+                memcpy(r + *n, src, sizeof src);
+                *n += 4;
+            }
+            break;
+        case 14:
+            if (*n + 4 <= SNAPSHOT_LEN) {
+                same &= !axv_insertN(w, (int64_t) i, src, 4);
+                memmove(r + i + 4, r + i, (*n - i) * sizeof(void *));
+                memcpy(r + i, src, sizeof src);
+                *n += 4;
+            }
+            break;
+        case 15:
+            if (*n) {
+                const uint64_t b = rng() % *n;
+                same &= !axv_swap(w, (int64_t) i, (int64_t) b);
+                void *t = r[i];
+                r[i] = r[b];
+                r[b] = t;
+            }
+            break;
+        default:
+            axv_clear(w);
+            *n = 0;
+            break;
+        }
+        for (uint64_t k = 0; k < count; ++k)
+            same &= equals(v[k], ref[k], len[k]);
+    }
+    CHECK(same);
+    for (uint64_t k = 0; k < count; ++k) {
+        axv_destroy(v[k]);
+        free(ref[k]);
+    }
+    CHECK(arena.live == 0 && arena.badSizes == 0 && arena.frees == arena.allocs);
+
+    // running out of memory while unsharing leaves both vectors as they were, and reading never copies
+    axvector *a = axv_newWithAllocator(0, &allocator);
+    for (uint64_t i = 0; i < 100; ++i)
+        axv_push(a, item(i));
+    axvector *s = axv_snapshot(a);
+    const uint64_t allocs = arena.allocs;
+    CHECK(s && axv_data(s) == axv_data(a) && axv_linearSearch(s, item(5)) == 5 && axv_count(a, item(7)) == 1);
+    CHECK(axv_pop(s) == item(99) && axv_popFront(s) == item(0) && axv_ulen(s) == 98 && arena.allocs == allocs);
+    arena.budget = 0;
+    CHECK(axv_set(a, 0, NULL) && axv_push(s, NULL) && !axv_reverse(a) && !axv_sort(s) && axv_resize(s, 200));
+    CHECK(axv_get(a, 0) == item(0) && axv_ulen(a) == 100 && axv_get(s, 0) == item(1) && axv_ulen(s) == 98);
+    arena.budget = UINT64_MAX;
+    CHECK(!axv_set(a, 0, NULL) && !axv_isShared(a) && axv_get(a, 0) == NULL && axv_get(s, 0) == item(1));
+
+    // the last vector left referencing the array takes it over without copying
+    const uint64_t before = arena.allocs;
+    CHECK(!axv_push(s, item(100)) && !axv_isShared(s) && arena.allocs == before && axv_get(s, 98) == item(100));
+
+    // resizing a shared vector copies its items to an array of the new size in a single allocation
+    axvector *t = axv_snapshot(s);
+    arena.budget = 1;
+    CHECK(!axv_resize(t, 200) && axv_ucap(t) == 200 && !axv_isShared(t) && equals(t, axv_data(s), 99));
+    arena.budget = UINT64_MAX;
+    axv_destroy(t);
+    axv_destroy(s);
+    axv_destroy(a);
+    CHECK(arena.live == 0 && arena.badSizes == 0);
+}
+
+
+static bool persistentEquals(axpvector *p, void **ref, uint64_t n) {
+    if (axpv_len(p) != n || axpv_at(p, (int64_t) n) != NULL || axpv_at(p, -(int64_t) n - 1) != NULL)
+        return false;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (axpv_at(p, (int64_t) i) != ref[i] || axpv_at(p, (int64_t) i - (int64_t) n) != ref[i])
+            return false;
+    }
+    return true;
+}
+
+
+/*
+    A version of a persistent vector along with the items it must hold, which no later update may change.
+*/
+typedef struct pversion {
+    axpvector *p;
+    void **items;
+    uint64_t len;
+} pversion;
+
+
+#define PVERSIONS 8
+#define PMAX 6000
+
+
+static void testPersistent(void) {
+    testArena arena = {0, 0, 0, 0, UINT64_MAX};
+    const axv_allocator allocator = {arenaAlloc, arenaRealloc, arenaFree, &arena};
+    void **src = malloc(2 * PMAX * sizeof(void *));
+    for (uint64_t i = 0; i < 2 * PMAX; ++i)
+        src[i] = item(i + 1);
+
+    // every update derives a new version from a random one and replaces another, so old versions keep sharing
+    pversion versions[PVERSIONS];
+    for (int i = 0; i < PVERSIONS; ++i)
+        versions[i] = (pversion) {axpv_new(&allocator), malloc(2 * PMAX * sizeof(void *)), 0};
+    void **ref = malloc(2 * PMAX * sizeof(void *));
+    uint64_t failures = 0;
+    for (int round = 0; round < 3000; ++round) {
+        pversion *from = &versions[rng() % PVERSIONS];
+        pversion *other = &versions[rng() % PVERSIONS];
+        axpvector *p = from->p;
+        uint64_t len = from->len;
+        memcpy(ref, from->items, len * sizeof(void *));
+        // now and then, the allocator fails after a few calls and the old versions must be left as they were
+        const bool oom = rng() % 16 == 0;
+        const uint64_t live = arena.live;
+        arena.budget = oom ? rng() % 4 : UINT64_MAX;
+        axpvector *q;
+        const uint64_t op = rng() % 8;
+        if (op == 0 || (op == 4 && len + other->len > PMAX)) {
+            // enough items to fill a leaf level and cross into the next one
+            const uint64_t n = rng() % 3 == 0 ? rng() % 2000 : rng() % 70;
+            const uint64_t m = n < PMAX - len ? n : PMAX - len;
+            void **items = src + rng() % PMAX;
+            q = axpv_pushN(p, items, m);
+            memcpy(ref + len, items, m * sizeof(void *));
+            len += m;
+        } else if (op == 1) {
+            void *x = item(rng() % 1000);
+            q = axpv_push(p, x);
+            ref[len] = x;
+            ++len;
+        } else if (op == 2) {
+            const uint64_t m = len == 0 ? 0 : rng() % (len < 40 ? len : 40) + 1;
+            q = axpv_copy(p);
+            for (uint64_t i = 0; q && i < m; ++i) {
+                axpvector *r = axpv_pop(q);
+                axpv_destroy(q);
+                q = r;
+            }
+            len -= m;
+        } else if (op == 3) {
+            const int64_t i = len == 0 ? 0 : (int64_t) (rng() % len) - (int64_t) (rng() % 2 * len);
+            void *x = item(rng() % 1000 + 5000);
+            q = axpv_set(p, i, x);
+            if (len == 0)
+                CHECK(q == NULL);
+            else
+                ref[i < 0 ? i + (int64_t) len : i] = x;
+        } else if (op == 4) {
+            q = axpv_concat(p, other->p);
+            memcpy(ref + len, other->items, other->len * sizeof(void *));
+            len += other->len;
+        } else if (op == 5) {
+            const uint64_t i1 = len == 0 ? 0 : rng() % len;
+            const uint64_t i2 = i1 + (len == i1 ? 0 : rng() % (len - i1 + 1));
+            q = axpv_slice(p, (int64_t) i1 - (int64_t) (rng() % 2 * len), (int64_t) i2);
+            memmove(ref, ref + i1, (i2 - i1) * sizeof(void *));
+            len = i2 - i1;
+        } else if (op == 6) {
+            // a round trip through a flat vector
+            axvector *flat = axpv_toVector(p);
+            CHECK(flat == NULL || (equals(flat, ref, len) && axv_getAllocator(flat) == &allocator));
+            q = NULL;
+            if (flat) {
+                q = axpv_fromVector(flat);
+                axv_destroy(flat);
+            }
+        } else {
+            q = axpv_copy(p);
+        }
+        arena.budget = UINT64_MAX;
+        if (!q) {
+            CHECK(oom || (op == 3 && len == 0));
+            CHECK(arena.live == live);
+            failures += oom;
+        } else {
+            CHECK(persistentEquals(q, ref, len));
+            pversion *to = &versions[rng() % PVERSIONS];
+            axpv_destroy(to->p);
+            to->p = q;
+            memcpy(to->items, ref, len * sizeof(void *));
+            to->len = len;
+        }
+        for (int i = 0; i < PVERSIONS; ++i)
+            CHECK(persistentEquals(versions[i].p, versions[i].items, versions[i].len));
+    }
+    CHECK(failures > 0);
+
+    for (int i = 0; i < PVERSIONS; ++i) {
+        axpv_destroy(versions[i].p);
+        free(versions[i].items);
+    }
+    CHECK(arena.live == 0 && arena.allocs == arena.frees && arena.badSizes == 0);
+
+    // a trie three levels deep, popped back down to the tail alone
+    axpvector *p = axpv_new(&allocator);
+    for (uint64_t i = 0; i < 2 * 32 * 32 * 32; i += PMAX) {
+        axpvector *q = axpv_pushN(p, src, PMAX < 2 * 32 * 32 * 32 - i ? PMAX : 2 * 32 * 32 * 32 - i);
+        axpv_destroy(p);
+        p = q;
+    }
+    CHECK(axpv_len(p) == 2 * 32 * 32 * 32 && axpv_at(p, 32 * 32 * 32) == src[32 * 32 * 32 % PMAX]);
+    axpvector *deep = axpv_copy(p);
+    while (axpv_len(p) > 0) {
+        axpvector *q = axpv_pop(p);
+        CHECK(q && axpv_len(q) == axpv_len(p) - 1);
+        CHECK(axpv_len(q) == 0 || axpv_at(q, -1) == src[(axpv_len(q) - 1) % PMAX]);
+        axpv_destroy(p);
+        p = q;
+    }
+    axpvector *q = axpv_pop(p);
+    CHECK(q && axpv_len(q) == 0);
+    CHECK(axpv_len(deep) == 2 * 32 * 32 * 32 && axpv_at(deep, -1) == src[(2 * 32 * 32 * 32 - 1) % PMAX]);
+    axpv_destroy(q);
+    axpv_destroy(p);
+    axpv_destroy(deep);
+    CHECK(arena.live == 0 && arena.allocs == arena.frees && arena.badSizes == 0);
+    free(ref);
+    free(src);
+}
+
+
+static void testRotate(void) {
+    // lengths around the stack buffer of the rotation and long enough for several block swaps
+    const uint64_t lengths[] = {0, 1, 2, 3, 31, 63, 64, 65, 127, 128, 129, 130, 200, 1000, 4099};
+    void **ref = malloc(4099 * sizeof(void *));
+    for (size_t l = 0; l < sizeof lengths / sizeof *lengths; ++l) {
+        const uint64_t n = lengths[l];
+        const int64_t len = (int64_t) n;
+        const int64_t ks[] = {0, 1, -1, len, -len, len - 1, -len + 1, len + 1, -len - 1, 2 * len + 3, -3 * len - 5,
+                              64, -64, 65, -65, len / 2, -len / 3, INT64_MAX, INT64_MIN + 1, INT64_MIN,
+                              (int64_t) (rng() % (n + 1)), -(int64_t) (rng() % (n + 1))};
+        axvector *v = randomVector(n, 1 << 20);
+        memcpy(ref, axv_data(v), n * sizeof(void *));
+        for (size_t j = 0; j < sizeof ks / sizeof *ks; ++j) {
+            CHECK(axv_rotate(v, ks[j]) == v);
+            rotateLoop(ref, n, ks[j]);
+            CHECK(equals(v, ref, n));
+        }
+
+        // a rotated snapshot leaves the vector it was taken of alone
+        axvector *s = axv_snapshot(v);
+        CHECK(s && axv_rotate(s, len / 3 + 1) == s && equals(v, ref, n));
+        rotateLoop(ref, n, len / 3 + 1);
+        CHECK(equals(s, ref, n));
+        axv_destroy(s);
+        rotateLoop(ref, n, -(len / 3 + 1));
+
+        for (int round = 0; round < 20; ++round) {
+            const uint64_t i1 = rng() % (n + 1);
+            const uint64_t i2 = i1 + rng() % (n - i1 + 1);
+            // either bound may be given from the end
+            const int64_t index1 = (int64_t) i1 - (int64_t) (rng() % 2 * (i1 < n) * n);
+            const int64_t index2 = (int64_t) i2 - (int64_t) (rng() % 2 * (i2 < n) * n);
+            CHECK(axv_reverseSection(v, index1, index2) == (i1 >= n));
+            for (uint64_t a = i1, b = i2; i1 < n && a + 1 < b; ++a, --b) {
+                void *tmp = ref[a];
+                ref[a] = ref[b - 1];
+                ref[b - 1] = tmp;
+            }
+            CHECK(equals(v, ref, n));
+        }
+        CHECK(axv_reverseSection(v, len + 1, len) && axv_reverseSection(v, 0, len + 1));
+        CHECK(axv_reverse(v) == v);
+        for (uint64_t a = 0; a < n / 2; ++a) {
+            void *tmp = ref[a];
+            ref[a] = ref[n - 1 - a];
+            ref[n - 1 - a] = tmp;
+        }
+        CHECK(equals(v, ref, n));
+        axv_destroy(v);
+    }
+    free(ref);
+}
+
+
+static const struct {
+    const char *name;
+    void (*fn)(void);
+} tests[] = {
+    {"sort", testSort},
+    {"radixSort", testRadixSort},
+    {"parallel", testParallel},
+    {"growth", testGrowth},
+    {"bulk", testBulk},
+    {"batchDestructor", testBatchDestructor},
+    {"allocator", testAllocator},
+    {"inline", testInline},
+    {"init", testInit},
+    {"kernels", testKernels},
+    {"typed", testTyped},
+    {"views", testViews},
+    {"deque", testDeque},
+    {"queue", testQueue},
+    {"cvec", testCvec},
+    {"stableSort", testStableSort},
+    {"sortedOps", testSortedOps},
+    {"index", testIndex},
+    {"setAlgebra", testSetAlgebra},
+    {"batchCallbacks", testBatchCallbacks},
+    {"stats", testStats},
+    {"shrink", testShrink},
+    {"largeBlocks", testLargeBlocks},
+    {"serialize", testSerialize},
+    {"cursor", testCursor},
+    {"snapshots", testSnapshots},
+    {"persistent", testPersistent},
+    {"rotate", testRotate},
+};
+
+
+int main(void) {
+    for (size_t t = 0; t < sizeof tests / sizeof *tests; ++t) {
+        const int before = failures;
+        tests[t].fn();
+        printf("%s: %s\n", tests[t].name, failures == before ? "ok" : "FAILED");
+    }
+    return failures != 0;
+}
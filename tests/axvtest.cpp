@@ -0,0 +1,274 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+/*
+    axvtest_cpp checks the C++ layer of axvector.hpp against the algorithms of the standard library on std::vector.
+    It is built as C++17 and run by ctest along with axvtest.
+*/
+
+#include "axvector.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <vector>
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+
+static int failures = 0;
+
+
+static void check(bool ok, const char *expr, const char *file, int line) {
+    if (!ok) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        ++failures;
+    }
+}
+
+
+static uint64_t rngState = 0x9e3779b97f4a7c15;
+
+
+static uint64_t rng() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+
+// lengths around the block size of the batch callbacks behind filter(), map() and partition()
+static const uint64_t lengths[] = {0, 1, 2, 255, 256, 257, 1000, 5000};
+
+
+template <class T>
+static bool equals(const axv::vectorRef<T> &v, const std::vector<T> &ref) {
+    return v.size() == ref.size() && std::equal(v.begin(), v.end(), ref.begin());
+}
+
+
+static axv::vector<uint64_t> randomVector(uint64_t n, uint64_t range, std::vector<uint64_t> &ref) {
+    axv::vector<uint64_t> v;
+    ref.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t x = rng() % range;
+        v.push(x);
+        ref.push_back(x);
+    }
+    return v;
+}
+
+
+/*
+    An allocator failing once budget calls to alloc or realloc have succeeded, to test running out of memory.
+*/
+struct budget {
+    uint64_t left;
+};
+
+
+static void *budgetAlloc(size_t size, void *ctx) {
+    budget *b = static_cast<budget *>(ctx);
+    if (b->left == 0)
+        return nullptr;
+    --b->left;
+    return std::malloc(size);
+}
+
+
+static void *budgetRealloc(void *ptr, size_t, size_t size, void *ctx) {
+    budget *b = static_cast<budget *>(ctx);
+    if (b->left == 0)
+        return nullptr;
+    --b->left;
+    return std::realloc(ptr, size);
+}
+
+
+static void budgetFree(void *ptr, size_t, void *) {
+    std::free(ptr);
+}
+
+
+static void testOwnership() {
+    axv::vector<int> v;
+    CHECK(v.empty() && v.size() == 0 && v.begin() == v.end());
+    for (int i = 0; i < 100; ++i)
+        CHECK(!v.push(i - 50));
+    CHECK(v.size() == 100 && v[0] == -50 && v.at(-1) == 49 && v.at(100) == 0);
+    CHECK(std::accumulate(v.begin(), v.end(), 0) == -50);
+    CHECK(!v.set(-2, 1000) && v[98] == 1000 && v.set(100, 0));
+    CHECK(v.pop() == 49 && v.size() == 99);
+
+    // a moved vector is owned by its new handle only, and a released one by the C code
+    axv::vector<int> w = std::move(v);
+    CHECK(w.size() == 99 && w.at(-1) == 1000);
+    axvector *raw = w.release();
+    CHECK(raw && axv_ulen(raw) == 99);
+    axv::vectorRef<int> ref(raw);
+    CHECK(ref.get() == raw && ref.at(0) == -50 && ref.end() - ref.begin() == 99);
+    CHECK(!ref.push(7) && axv_get(raw, 99) == axv::detail::toItem(7));
+    axv::vector<int> adopted = axv::vector<int>::adopt(raw);
+    CHECK(adopted.size() == 100 && adopted.get() == raw);
+
+    // copies and snapshots stay apart from the vector they were made of
+    axv::vector<int> c = adopted.copy();
+    axv::vector<int> s = adopted.snapshot();
+    CHECK(!s.set(0, 5) && !c.set(1, 6));
+    CHECK(adopted[0] == -50 && adopted[1] == -49 && s[0] == 5 && s[1] == -49 && c[0] == -50 && c[1] == 6);
+    adopted.clear();
+    CHECK(adopted.empty() && s.size() == 100 && c.size() == 100);
+
+    // pointer items
+    static int values[3] = {1, 2, 3};
+    axv::vector<int *> p(4);
+    for (int &x : values)
+        p.push(&x);
+    CHECK(p.size() == 3 && *p[1] == 2 && p.at(-1) == values + 2);
+
+    budget b = {0};
+    const axv_allocator allocator = {budgetAlloc, budgetRealloc, budgetFree, &b};
+    bool thrown = false;
+    try {
+        axv::vector<int> failed(0, &allocator);
+    } catch (const std::bad_alloc &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+
+static void testSort() {
+    for (uint64_t n : lengths) {
+        std::vector<uint64_t> ref;
+        axv::vector<uint64_t> v = randomVector(n, n / 2 + 1, ref);
+        axv::vector<uint64_t> s = v.snapshot();
+        CHECK(!v.sort([](uint64_t a, uint64_t b) { return a > b; }));
+        std::vector<uint64_t> sorted = ref;
+        std::sort(sorted.begin(), sorted.end(), [](uint64_t a, uint64_t b) { return a > b; });
+        CHECK(equals(v, sorted) && equals(s, ref));
+
+        // by the comparator of the vector, which compares the items as addresses by default
+        CHECK(!s.sort());
+        std::sort(sorted.begin(), sorted.end());
+        CHECK(equals(s, sorted));
+
+        // a stateful predicate, by the last digit and then the rest
+        uint64_t calls = 0;
+        CHECK(!v.sort([&calls](uint64_t a, uint64_t b) {
+            ++calls;
+            return a % 10 != b % 10 ? a % 10 < b % 10 : a < b;
+        }));
+        std::sort(sorted.begin(), sorted.end(),
+                  [](uint64_t a, uint64_t b) { return a % 10 != b % 10 ? a % 10 < b % 10 : a < b; });
+        CHECK(equals(v, sorted) && (n < 2 || calls > 0));
+    }
+
+    struct point {
+        int x, y;
+    };
+    std::vector<point> points(300);
+    axv::vector<point *> p;
+    for (point &q : points) {
+        q = {static_cast<int>(rng() % 50), static_cast<int>(rng() % 50)};
+        p.push(&q);
+    }
+    CHECK(!p.sort([](const point *a, const point *b) { return a->x < b->x; }));
+    CHECK(p.size() == 300 && std::is_sorted(p.begin(), p.end(), [](point *a, point *b) { return a->x < b->x; }));
+}
+
+
+static void testFilterMapPartition() {
+    for (uint64_t n : lengths) {
+        std::vector<uint64_t> ref;
+        axv::vector<uint64_t> v = randomVector(n, 1000, ref);
+        axv::vector<uint64_t> s = v.snapshot();
+
+        uint64_t threshold = 300;
+        CHECK(!v.filter([&threshold](uint64_t x) { return x < threshold; }));
+        std::vector<uint64_t> kept;
+        std::copy_if(ref.begin(), ref.end(), std::back_inserter(kept), [](uint64_t x) { return x < 300; });
+        CHECK(equals(v, kept) && equals(s, ref));
+
+        // items are mapped from first to last, which the running sum relies on
+        uint64_t sum = 0;
+        CHECK(!v.map([&sum](uint64_t x) { return sum += x; }));
+        std::partial_sum(kept.begin(), kept.end(), kept.begin());
+        CHECK(equals(v, kept) && sum == (kept.empty() ? 0 : kept.back()));
+
+        axv::vector<uint64_t> rejected = s.partition([](uint64_t x) { return x % 3 == 0; });
+        std::vector<uint64_t> yes, no;
+        for (uint64_t x : ref)
+            (x % 3 == 0 ? yes : no).push_back(x);
+        CHECK(equals(s, yes) && equals(rejected, no));
+    }
+
+    axv::vector<int> w;
+    for (int i = -10; i < 10; ++i)
+        w.push(i);
+    CHECK(!w.map([](int x) { return x * x; }) && !w.filter([](int x) { return x > 50; }));
+    CHECK(equals(w, std::vector<int>{100, 81, 64, 64, 81}));
+
+    // partitioning throws and leaves the vector as it was if the vector for the rejected items cannot be made
+    budget b = {UINT64_MAX};
+    const axv_allocator allocator = {budgetAlloc, budgetRealloc, budgetFree, &b};
+    axv::vector<int> f(16, &allocator);
+    for (int i = 0; i < 10; ++i)
+        f.push(i);
+    b.left = 0;
+    bool thrown = false;
+    try {
+        f.partition([](int x) { return x < 5; });
+    } catch (const std::bad_alloc &) {
+        thrown = true;
+    }
+    CHECK(thrown && f.size() == 10 && f[9] == 9);
+}
+
+
+static void testFindCount() {
+    for (uint64_t n : lengths) {
+        std::vector<uint64_t> ref;
+        axv::vector<uint64_t> v = randomVector(n, 2 * n + 1, ref);
+        for (uint64_t x : {uint64_t(0), n / 2, n, 2 * n}) {
+            const auto greater = [x](uint64_t y) { return y >= x; };
+            const auto it = std::find_if(ref.begin(), ref.end(), greater);
+            CHECK(v.find(greater) == (it == ref.end() ? -1 : it - ref.begin()));
+            CHECK(v.count(greater) == static_cast<uint64_t>(std::count_if(ref.begin(), ref.end(), greater)));
+        }
+        CHECK(v.find([](uint64_t) { return false; }) == -1 && v.count([](uint64_t) { return true; }) == n);
+    }
+
+    enum colour { red, green, blue };
+    axv::vector<colour> c;
+    for (int i = 0; i < 100; ++i)
+        c.push(static_cast<colour>(i % 3));
+    CHECK(c.find([](colour x) { return x == blue; }) == 2 && c.count([](colour x) { return x == red; }) == 34);
+}
+
+
+static const struct {
+    const char *name;
+    void (*fn)();
+} tests[] = {
+    {"ownership", testOwnership},
+    {"sort", testSort},
+    {"filterMapPartition", testFilterMapPartition},
+    {"findCount", testFindCount},
+};
+
+
+int main() {
+    for (const auto &test : tests) {
+        const int before = failures;
+        test.fn();
+        std::printf("%s: %s\n", test.name, failures == before ? "ok" : "FAILED");
+    }
+    return failures != 0;
+}